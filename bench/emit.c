@@ -0,0 +1,134 @@
+#include <time.h>
+
+#include "../lang/muon.c"
+
+//---------------------------------------
+// EMIT BENCHMARK
+//---------------------------------------
+
+// writes the fragments the emitters produce for a call heavy program
+// through one stdio call each, the way output_t used to, and through
+// the buffered output_t. then times the real emitters on a parsed
+// synthetic source
+
+#define BENCH_CALLS  (2 * 1024 * 1024)
+#define BENCH_SIZE   (8 * 1024 * 1024)
+#define BENCH_ROUNDS 5
+
+double bench_now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// -- REFERENCE -------------------------
+
+void ref_emit(FILE *file, char *str) {
+  fprintf(file, "%s", str);
+}
+
+// (printf "%d %f\n" i 2.5) as a statement
+void ref_call(FILE *file, int i) {
+  ref_emit(file, "printf");
+  ref_emit(file, "(");
+  ref_emit(file, "\"");
+  ref_emit(file, "%d %f\\n");
+  ref_emit(file, "\"");
+  ref_emit(file, ", ");
+  fprintf(file, "%d", i);
+  ref_emit(file, ", ");
+  fprintf(file, "%lf", i * 0.25);
+  ref_emit(file, ")");
+  fprintf(file, "%s\n", ";");
+}
+
+void new_call(output_t *out, int i) {
+  emit(out, "printf");
+  emit(out, "(");
+  emit(out, "\"");
+  emit(out, "%d %f\\n");
+  emit(out, "\"");
+  emit(out, ", ");
+  emit_int(out, i);
+  emit(out, ", ");
+  emit_float(out, i * 0.25);
+  emit(out, ")");
+  emit_line(out, ";");
+}
+
+// -- EMITTERS --------------------------
+
+FILE *bench_source() {
+  const char *part =
+    "walk(this : *node_t, f : (*node_t) -> void) -> int\n"
+    "i : int = 0; {\n"
+    "loop:\n"
+    "  (f this (mul 2.5 i) 'c' \"name\");\n"
+    "  (set i (add i 1));\n"
+    "  (set this (pget this next));\n"
+    "  jmp (ne this 0) loop;\n"
+    "  ret i;\n"
+    "}\n";
+  FILE *file = tmpfile();
+  if(!file) panic("unable to create benchmark source");
+  for(ulong n = 0; n < BENCH_SIZE; n += fprintf(file, "%s", part));
+  fflush(file);
+  return file;
+}
+
+// parses every item and emits it to out | returns the seconds spent
+// emitting
+double bench_emit(FILE *file, output_t *out) {
+  FILE *copy = fdopen(dup(fileno(file)), "r");
+  if(!copy) panic("unable to reopen benchmark source");
+  parser_t *parser = parser_create(input_new(copy));
+  double total = 0;
+  for(node_t *node = 0; (node = parse(parser));) {
+    double t = bench_now();
+    int more = item_emit(node, out);
+    total += bench_now() - t;
+    if(!more) break;
+    parser_commit(parser);
+  }
+  parser_free(parser);
+  return total;
+}
+
+int main() {
+  FILE *sink = fopen("/dev/null", "w");
+  if(!sink) panic("unable to open /dev/null");
+  output_t *out = output_new(sink);
+  double best[3] = { 1e9, 1e9, 1e9 };
+  const char *names[3] = { "stdio per fragment (old)", "buffered", "emitters" };
+  ulong bytes = 0;
+  for(int r = 0; r < BENCH_ROUNDS; r++) {
+    double t = bench_now();
+    for(int i = 0; i < BENCH_CALLS; i++) ref_call(sink, i);
+    fflush(sink);
+    if((t = bench_now() - t) < best[0]) best[0] = t;
+    t = bench_now();
+    for(int i = 0; i < BENCH_CALLS; i++) new_call(out, i);
+    output_flush(out);
+    if((t = bench_now() - t) < best[1]) best[1] = t;
+  }
+  // the size of the fragment output
+  FILE *count = tmpfile();
+  for(int i = 0; i < BENCH_CALLS; i++) ref_call(count, i);
+  bytes = ftell(count);
+  fclose(count);
+  double mb = bytes / (1024.0 * 1024.0);
+  for(int i = 0; i < 2; i++) {
+    printf("%-26s %8.2f ms %8.1f MB/s\n", names[i], best[i] * 1000, mb / best[i]);
+  }
+
+  FILE *file = bench_source();
+  for(int r = 0; r < BENCH_ROUNDS; r++) {
+    double t = bench_emit(file, out);
+    if(t < best[2]) best[2] = t;
+  }
+  output_flush(out);
+  printf("%-26s %8.2f ms %8.1f MB/s of source\n", names[2], best[2] * 1000, BENCH_SIZE / (1024.0 * 1024.0) / best[2]);
+  fclose(file);
+  output_free(out);
+  return 0;
+}
@@ -0,0 +1,86 @@
+#include <time.h>
+
+#include "../lang/muon.c"
+
+//---------------------------------------
+// PARSER BENCHMARK
+//---------------------------------------
+
+// parses a synthetic source of top-level items with the interpreted
+// combinators and the vm | built with -DGEN_PARSER it runs the
+// generated parser instead, so both binaries read the same input
+
+#define BENCH_SIZE  (16 * 1024 * 1024)
+#define BENCH_ROUNDS 5
+
+double bench_now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+FILE *bench_source() {
+  const char *parts[] = {
+    "// structure\n"
+    "node_t {\n  id : *char;\n  next : *node_t;\n  vals : [int; 16];\n}\n",
+    "node_t;\n",
+    "extern count : int;\n",
+    "head : *node_t = (init 0);\n",
+    "visit((*node_t) -> void, *node_t) -> void;\n",
+    "walk(this : *node_t, f : (*node_t) -> void) -> int\n"
+    "i : int = 0; {\n"
+    "loop:\n"
+    "  (f this);\n"
+    "  (set i (add i 1));\n"
+    "  (set this (pget this next));\n"
+    "  jmp (ne this 0) loop;\n"
+    "  (printf \"visited %d nodes %c\\n\" i '!');\n"
+    "  ret i;\n"
+    "}\n"
+  };
+  FILE *file = tmpfile();
+  if(!file) panic("unable to create benchmark source");
+  for(ulong n = 0; n < BENCH_SIZE;) {
+    for(int i = 0; i < sizeof(parts) / sizeof(parts[0]); i++) n += fprintf(file, "%s", parts[i]);
+  }
+  fflush(file);
+  return file;
+}
+
+// parses every item of the source | returns the number of items
+ulong bench_parse(FILE *file, int vm) {
+  FILE *copy = fdopen(dup(fileno(file)), "r");
+  if(!copy) panic("unable to reopen benchmark source");
+  parser_t *parser = parser_create(input_new(copy));
+  if(vm) parser->vm = vm_new(parser->base);
+  ulong items = 0;
+  for(node_t *node = 0; (node = parse(parser)); items++) {
+    if(node->type == EOF_NODE) break;
+    parser_commit(parser);
+  }
+  parser_free(parser);
+  return items;
+}
+
+int main() {
+  FILE *file = bench_source();
+  double mb = BENCH_SIZE / (1024.0 * 1024.0);
+#ifdef GEN_PARSER
+  const char *names[] = { "generated" };
+#else
+  const char *names[] = { "combinators", "vm" };
+#endif
+  int modes = sizeof(names) / sizeof(names[0]);
+  for(int m = 0; m < modes; m++) {
+    double best = 1e9;
+    ulong items = 0;
+    for(int r = 0; r < BENCH_ROUNDS; r++) {
+      double t = bench_now();
+      items = bench_parse(file, m);
+      if((t = bench_now() - t) < best) best = t;
+    }
+    printf("%-12s %8.2f ms %8.1f MB/s %8lu items\n", names[m], best * 1000, mb / best, items);
+  }
+  fclose(file);
+  return 0;
+}
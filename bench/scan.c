@@ -0,0 +1,128 @@
+#include <time.h>
+
+#include "../lang/muon.c"
+
+//---------------------------------------
+// SCANNER BENCHMARK
+//---------------------------------------
+
+// compares the char at a time scanner the lexer used before
+// with the table driven and the simd scanners on a synthetic
+// source made of comment banners, deep indentation and long
+// identifier and number runs
+
+#define BENCH_SIZE  (32 * 1024 * 1024)
+#define BENCH_ROUNDS 5
+
+// -- REFERENCE -------------------------
+
+int ref_is_num(char _c) {
+  return (_c >= '0' && _c <= '9');
+}
+
+int ref_is_alpha_num(char _c) {
+  return ((_c >= 'a' && _c <= 'z') || (_c >= 'A' && _c <= 'Z') || (_c >= '0' && _c <= '9') || _c == '_');
+}
+
+void ref_skip(input_t *this) {
+  ulong i = this->pos;
+  for(char c = 0; (c = input_at(this, i));) {
+    if(strchr(" \n\r\t", c)) {
+      i++;
+    } else if(c == '/' && input_at(this, i + 1) == '/') {
+      for(i += 2; (c = input_at(this, i)) && c != '\n'; i++);
+    } else if(c == '/' && input_at(this, i + 1) == '*') {
+      for(i += 2; (c = input_at(this, i)) && !(c == '*' && input_at(this, i + 1) == '/'); i++);
+      if(c) i += 2;
+    } else {
+      break;
+    }
+  }
+  this->pos = i;
+}
+
+void ref_lex(input_t *in) {
+  for(;;) {
+    ref_skip(in);
+    char c = input_peek(in);
+    if(!c) return;
+    if(ref_is_alpha_num(c)) {
+      while(ref_is_alpha_num(input_peek(in))) input_next(in);
+    } else {
+      input_next(in);
+    }
+  }
+}
+
+// -- TABLE | SIMD ----------------------
+
+void new_lex(input_t *in, scan_f space, scan_f alpha_num) {
+  for(;;) {
+    input_skip_with(in, space);
+    char c = input_peek(in);
+    if(!c) return;
+    if(is_alpha_num(c)) {
+      input_scan(in, alpha_num);
+    } else {
+      input_next(in);
+    }
+  }
+}
+
+// --  ----------------------------------
+
+double bench_now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+FILE *bench_source() {
+  const char *parts[] = {
+    "/****************************************************************\n"
+    " * generated module banner                                      *\n"
+    " ****************************************************************/\n",
+    "                        some_rather_long_generated_identifier_0123 : int = 1234567890;\n",
+    "                                // indented line comment for the next statement\n",
+    "                                (add value_of_the_first_operand 42);\n"
+  };
+  FILE *file = tmpfile();
+  if(!file) panic("unable to create benchmark source");
+  for(ulong n = 0; n < BENCH_SIZE;) {
+    for(int i = 0; i < 4; i++) n += fprintf(file, "%s", parts[i]);
+  }
+  fflush(file);
+  rewind(file);
+  return file;
+}
+
+int main() {
+  input_t *in = input_new(bench_source());
+  double mb = in->len / (1024.0 * 1024.0);
+  double best[4] = { 1e9, 1e9, 1e9, 1e9 };
+  const char *names[4] = { "char at a time (old)", "table scalar", "simd", "memchr baseline" };
+  for(int r = 0; r < BENCH_ROUNDS; r++) {
+    double t = 0;
+    in->pos = 0; t = bench_now(); ref_lex(in);
+    if((t = bench_now() - t) < best[0]) best[0] = t;
+    in->pos = 0; t = bench_now(); new_lex(in, scan_space_scalar, scan_alpha_num_scalar);
+    if((t = bench_now() - t) < best[1]) best[1] = t;
+    in->pos = 0; t = bench_now(); new_lex(in, scan_space, scan_alpha_num);
+    if((t = bench_now() - t) < best[2]) best[2] = t;
+    t = bench_now();
+    if(memchr(in->data, 0, in->len)) panic("unexpected zero byte");
+    if((t = bench_now() - t) < best[3]) best[3] = t;
+  }
+#if defined(__AVX2__)
+  printf("simd path: avx2\n");
+#elif defined(__SSE2__)
+  printf("simd path: sse2\n");
+#else
+  printf("simd path: none (scalar fallback)\n");
+#endif
+  for(int i = 0; i < 4; i++) {
+    printf("%-22s %8.2f ms %10.1f MB/s\n", names[i], best[i] * 1000, mb / best[i]);
+  }
+  input_free(in);
+  return 0;
+}
@@ -0,0 +1,869 @@
+// generated by comp --gen-parser | do not edit
+
+static inline int gen_class(lexer_t *lexer) {
+  token_t *tok = lexer_peek(lexer);
+  return tok->kind == TOK_OP ? TOK_ERR + 1 + tok->sym : tok->kind;
+}
+
+static inline node_t *gen_match(lexer_t *lexer, token_e kind, int sym, node_type type) {
+  token_t *tok = lexer_peek(lexer);
+  if(tok->kind != kind || tok->sym != sym) return 0;
+  lexer_next(lexer);
+  return node_new(type);
+}
+
+// elements of the lists being parsed
+static node_t **gen_values;
+static ulong  gen_value_len, gen_value_cap;
+
+static inline void gen_push(node_t *node) {
+  gen_values = grow(gen_values, &gen_value_cap, gen_value_len, sizeof(node_t*));
+  gen_values[gen_value_len++] = node;
+}
+
+static node_t *gen_base(lexer_t *lexer);
+static node_t *gen_1(lexer_t *lexer);
+static node_t *gen_struct_decl(lexer_t *lexer);
+static node_t *gen_struct(lexer_t *lexer);
+static node_t *gen_var_list(lexer_t *lexer);
+static node_t *gen_var(lexer_t *lexer);
+static node_t *gen_type(lexer_t *lexer);
+static node_t *gen_arr_type(lexer_t *lexer);
+static node_t *gen_14(lexer_t *lexer);
+static node_t *gen_15(lexer_t *lexer);
+static node_t *gen_16(lexer_t *lexer);
+static node_t *gen_exp(lexer_t *lexer);
+static node_t *gen_int_exp(lexer_t *lexer);
+static node_t *gen_id_exp(lexer_t *lexer);
+static node_t *gen_str_exp(lexer_t *lexer);
+static node_t *gen_float_exp(lexer_t *lexer);
+static node_t *gen_char_exp(lexer_t *lexer);
+static node_t *gen_call_exp(lexer_t *lexer);
+static node_t *gen_exp_list(lexer_t *lexer);
+static node_t *gen_32(lexer_t *lexer);
+static node_t *gen_fun_type(lexer_t *lexer);
+static node_t *gen_type_list(lexer_t *lexer);
+static node_t *gen_ptr_type(lexer_t *lexer);
+static node_t *gen_40(lexer_t *lexer);
+static node_t *gen_id_type(lexer_t *lexer);
+static node_t *gen_43(lexer_t *lexer);
+static node_t *gen_var_def(lexer_t *lexer);
+static node_t *gen_var_decl(lexer_t *lexer);
+static node_t *gen_49(lexer_t *lexer);
+static node_t *gen_50(lexer_t *lexer);
+static node_t *gen_51(lexer_t *lexer);
+static node_t *gen_fun_decl(lexer_t *lexer);
+static node_t *gen_fun(lexer_t *lexer);
+static node_t *gen_param_list(lexer_t *lexer);
+static node_t *gen_var_def_list(lexer_t *lexer);
+static node_t *gen_stm_list(lexer_t *lexer);
+static node_t *gen_stm(lexer_t *lexer);
+static node_t *gen_exp_stm(lexer_t *lexer);
+static node_t *gen_label_stm(lexer_t *lexer);
+static node_t *gen_62(lexer_t *lexer);
+static node_t *gen_jmp_stm(lexer_t *lexer);
+static node_t *gen_jmp_con_stm(lexer_t *lexer);
+static node_t *gen_ret_stm(lexer_t *lexer);
+
+static node_t *gen_base(lexer_t *lexer) {
+  ulong pos = lexer_tell(lexer);
+  node_t *res = 0;
+  switch(gen_class(lexer)) {
+    case TOK_EOF:
+      if((res = parse_eof(0, lexer))) {
+        return res;
+      }
+      lexer_seek(lexer, pos);
+      if(lexer->failed) break;
+      break;
+    case TOK_ID:
+      if((res = gen_1(lexer))) {
+        return res;
+      }
+      lexer_seek(lexer, pos);
+      if(lexer->failed) break;
+      if((res = gen_var_def(lexer))) {
+        return res;
+      }
+      lexer_seek(lexer, pos);
+      if(lexer->failed) break;
+      if((res = gen_var_decl(lexer))) {
+        return res;
+      }
+      lexer_seek(lexer, pos);
+      if(lexer->failed) break;
+      if((res = gen_51(lexer))) {
+        return res;
+      }
+      lexer_seek(lexer, pos);
+      if(lexer->failed) break;
+      break;
+  }
+  return 0;
+}
+
+static node_t *gen_1(lexer_t *lexer) {
+  ulong pos = lexer_tell(lexer);
+  ulong mark = arena_mark(&node_arena);
+  node_t *res = 0;
+  node_t *prefix = parse_id(0, lexer);
+  if(!prefix) return 0;
+  switch(gen_class(lexer)) {
+    case TOK_ERR + 1 + 0: // ;
+      if((res = gen_struct_decl(lexer))) {
+        return node_prepend(res, prefix);
+      }
+      if(lexer->failed) break;
+      break;
+    case TOK_ERR + 1 + 1: // {
+      if((res = gen_struct(lexer))) {
+        return node_prepend(res, prefix);
+      }
+      if(lexer->failed) break;
+      break;
+  }
+  node_rewind(mark);
+  lexer_seek(lexer, pos);
+  return 0;
+}
+
+static node_t *gen_struct_decl(lexer_t *lexer) {
+  ulong pos = lexer_tell(lexer);
+  ulong mark = arena_mark(&node_arena);
+  if(!(gen_match(lexer, TOK_OP, 0, 39))) goto fail;
+  return node_build(4, 0, 0);
+fail:
+  node_rewind(mark);
+  lexer_seek(lexer, pos);
+  return 0;
+}
+
+static node_t *gen_struct(lexer_t *lexer) {
+  ulong pos = lexer_tell(lexer);
+  ulong mark = arena_mark(&node_arena);
+  node_t *kids[1];
+  if(!(gen_match(lexer, TOK_OP, 1, 30))) goto fail;
+  if(!(kids[0] = gen_var_list(lexer))) goto fail;
+  if(!(gen_43(lexer))) goto fail;
+  return node_build(5, kids, 1);
+fail:
+  node_rewind(mark);
+  lexer_seek(lexer, pos);
+  return 0;
+}
+
+static node_t *gen_var_list(lexer_t *lexer) {
+  ulong pos = lexer_tell(lexer);
+  ulong mark = arena_mark(&node_arena);
+  ulong base = gen_value_len;
+  node_t *node = 0;
+  while((node = gen_var(lexer))) {
+    gen_push(node);
+    if(!(node = gen_match(lexer, TOK_OP, 0, 39))) {
+      gen_value_len = base;
+      node_rewind(mark);
+      lexer_seek(lexer, pos);
+      return 0;
+    }
+  }
+  if(lexer->failed) {
+    gen_value_len = base;
+    return 0;
+  }
+  node = node_build(8, gen_values + base, gen_value_len - base);
+  gen_value_len = base;
+  return node;
+}
+
+static node_t *gen_var(lexer_t *lexer) {
+  ulong pos = lexer_tell(lexer);
+  ulong mark = arena_mark(&node_arena);
+  node_t *kids[2];
+  if(!(kids[0] = parse_id(0, lexer))) goto fail;
+  if(!(gen_match(lexer, TOK_OP, 2, 38))) goto fail;
+  if(!(kids[1] = gen_type(lexer))) goto fail;
+  return node_build(7, kids, 2);
+fail:
+  node_rewind(mark);
+  lexer_seek(lexer, pos);
+  return 0;
+}
+
+static node_t *gen_type(lexer_t *lexer) {
+  ulong pos = lexer_tell(lexer);
+  node_t *res = 0;
+  switch(gen_class(lexer)) {
+    case TOK_ID:
+      if((res = gen_id_type(lexer))) {
+        return res;
+      }
+      lexer_seek(lexer, pos);
+      if(lexer->failed) break;
+      break;
+    case TOK_ERR + 1 + 3: // [
+      if((res = gen_arr_type(lexer))) {
+        return res;
+      }
+      lexer_seek(lexer, pos);
+      if(lexer->failed) break;
+      break;
+    case TOK_ERR + 1 + 4: // (
+      if((res = gen_fun_type(lexer))) {
+        return res;
+      }
+      lexer_seek(lexer, pos);
+      if(lexer->failed) break;
+      break;
+    case TOK_ERR + 1 + 9: // *
+      if((res = gen_ptr_type(lexer))) {
+        return res;
+      }
+      lexer_seek(lexer, pos);
+      if(lexer->failed) break;
+      break;
+  }
+  return 0;
+}
+
+static node_t *gen_arr_type(lexer_t *lexer) {
+  ulong pos = lexer_tell(lexer);
+  ulong mark = arena_mark(&node_arena);
+  node_t *kids[2];
+  if(!(gen_match(lexer, TOK_OP, 3, 34))) goto fail;
+  if(!(kids[0] = gen_14(lexer))) goto fail;
+  if(!(gen_15(lexer))) goto fail;
+  if(!(kids[1] = gen_16(lexer))) goto fail;
+  if(!(gen_32(lexer))) goto fail;
+  return node_build(15, kids, 2);
+fail:
+  node_rewind(mark);
+  lexer_seek(lexer, pos);
+  return 0;
+}
+
+static node_t *gen_14(lexer_t *lexer) {
+  node_t *node = gen_type(lexer);
+  if(!node && !lexer->failed) parse_error("type", lexer);
+  return node;
+}
+
+static node_t *gen_15(lexer_t *lexer) {
+  node_t *node = gen_match(lexer, TOK_OP, 0, 39);
+  if(!node && !lexer->failed) parse_error(";", lexer);
+  return node;
+}
+
+static node_t *gen_16(lexer_t *lexer) {
+  node_t *node = gen_exp(lexer);
+  if(!node && !lexer->failed) parse_error("expression", lexer);
+  return node;
+}
+
+static node_t *gen_exp(lexer_t *lexer) {
+  ulong pos = lexer_tell(lexer);
+  node_t *res = 0;
+  switch(gen_class(lexer)) {
+    case TOK_ID:
+      if((res = gen_id_exp(lexer))) {
+        return res;
+      }
+      lexer_seek(lexer, pos);
+      if(lexer->failed) break;
+      break;
+    case TOK_INT:
+      if((res = gen_int_exp(lexer))) {
+        return res;
+      }
+      lexer_seek(lexer, pos);
+      if(lexer->failed) break;
+      break;
+    case TOK_FLOAT:
+      if((res = gen_float_exp(lexer))) {
+        return res;
+      }
+      lexer_seek(lexer, pos);
+      if(lexer->failed) break;
+      break;
+    case TOK_CHAR:
+      if((res = gen_char_exp(lexer))) {
+        return res;
+      }
+      lexer_seek(lexer, pos);
+      if(lexer->failed) break;
+      break;
+    case TOK_STR:
+      if((res = gen_str_exp(lexer))) {
+        return res;
+      }
+      lexer_seek(lexer, pos);
+      if(lexer->failed) break;
+      break;
+    case TOK_ERR + 1 + 4: // (
+      if((res = gen_call_exp(lexer))) {
+        return res;
+      }
+      lexer_seek(lexer, pos);
+      if(lexer->failed) break;
+      break;
+  }
+  return 0;
+}
+
+static node_t *gen_int_exp(lexer_t *lexer) {
+  ulong pos = lexer_tell(lexer);
+  ulong mark = arena_mark(&node_arena);
+  node_t *kids[1];
+  if(!(kids[0] = parse_int(0, lexer))) goto fail;
+  return node_build(23, kids, 1);
+fail:
+  node_rewind(mark);
+  lexer_seek(lexer, pos);
+  return 0;
+}
+
+static node_t *gen_id_exp(lexer_t *lexer) {
+  ulong pos = lexer_tell(lexer);
+  ulong mark = arena_mark(&node_arena);
+  node_t *kids[1];
+  if(!(kids[0] = parse_id(0, lexer))) goto fail;
+  return node_build(24, kids, 1);
+fail:
+  node_rewind(mark);
+  lexer_seek(lexer, pos);
+  return 0;
+}
+
+static node_t *gen_str_exp(lexer_t *lexer) {
+  ulong pos = lexer_tell(lexer);
+  ulong mark = arena_mark(&node_arena);
+  node_t *kids[1];
+  if(!(kids[0] = parse_str(0, lexer))) goto fail;
+  return node_build(26, kids, 1);
+fail:
+  node_rewind(mark);
+  lexer_seek(lexer, pos);
+  return 0;
+}
+
+static node_t *gen_float_exp(lexer_t *lexer) {
+  ulong pos = lexer_tell(lexer);
+  ulong mark = arena_mark(&node_arena);
+  node_t *kids[1];
+  if(!(kids[0] = parse_float(0, lexer))) goto fail;
+  return node_build(25, kids, 1);
+fail:
+  node_rewind(mark);
+  lexer_seek(lexer, pos);
+  return 0;
+}
+
+static node_t *gen_char_exp(lexer_t *lexer) {
+  ulong pos = lexer_tell(lexer);
+  ulong mark = arena_mark(&node_arena);
+  node_t *kids[1];
+  if(!(kids[0] = parse_char(0, lexer))) goto fail;
+  return node_build(28, kids, 1);
+fail:
+  node_rewind(mark);
+  lexer_seek(lexer, pos);
+  return 0;
+}
+
+static node_t *gen_call_exp(lexer_t *lexer) {
+  ulong pos = lexer_tell(lexer);
+  ulong mark = arena_mark(&node_arena);
+  node_t *kids[1];
+  if(!(gen_match(lexer, TOK_OP, 4, 32))) goto fail;
+  if(!(kids[0] = gen_exp_list(lexer))) goto fail;
+  if(!(gen_match(lexer, TOK_OP, 5, 33))) goto fail;
+  return node_build(27, kids, 1);
+fail:
+  node_rewind(mark);
+  lexer_seek(lexer, pos);
+  return 0;
+}
+
+static node_t *gen_exp_list(lexer_t *lexer) {
+  ulong base = gen_value_len;
+  node_t *node = 0;
+  while((node = gen_exp(lexer))) {
+    gen_push(node);
+  }
+  if(lexer->failed) {
+    gen_value_len = base;
+    return 0;
+  }
+  node = node_build(29, gen_values + base, gen_value_len - base);
+  gen_value_len = base;
+  return node;
+}
+
+static node_t *gen_32(lexer_t *lexer) {
+  node_t *node = gen_match(lexer, TOK_OP, 6, 35);
+  if(!node && !lexer->failed) parse_error("]", lexer);
+  return node;
+}
+
+static node_t *gen_fun_type(lexer_t *lexer) {
+  ulong pos = lexer_tell(lexer);
+  ulong mark = arena_mark(&node_arena);
+  node_t *kids[2];
+  if(!(gen_match(lexer, TOK_OP, 4, 32))) goto fail;
+  if(!(kids[0] = gen_type_list(lexer))) goto fail;
+  if(!(gen_match(lexer, TOK_OP, 5, 33))) goto fail;
+  if(!(gen_match(lexer, TOK_OP, 8, 36))) goto fail;
+  if(!(kids[1] = gen_type(lexer))) goto fail;
+  return node_build(14, kids, 2);
+fail:
+  node_rewind(mark);
+  lexer_seek(lexer, pos);
+  return 0;
+}
+
+static node_t *gen_type_list(lexer_t *lexer) {
+  ulong base = gen_value_len;
+  node_t *node = 0;
+  while((node = gen_type(lexer))) {
+    gen_push(node);
+    if(!(node = gen_match(lexer, TOK_OP, 7, 37))) {
+      break;
+    }
+  }
+  if(lexer->failed) {
+    gen_value_len = base;
+    return 0;
+  }
+  node = node_build(16, gen_values + base, gen_value_len - base);
+  gen_value_len = base;
+  return node;
+}
+
+static node_t *gen_ptr_type(lexer_t *lexer) {
+  ulong pos = lexer_tell(lexer);
+  ulong mark = arena_mark(&node_arena);
+  node_t *kids[1];
+  if(!(gen_match(lexer, TOK_OP, 9, 41))) goto fail;
+  if(!(kids[0] = gen_40(lexer))) goto fail;
+  return node_build(13, kids, 1);
+fail:
+  node_rewind(mark);
+  lexer_seek(lexer, pos);
+  return 0;
+}
+
+static node_t *gen_40(lexer_t *lexer) {
+  node_t *node = gen_type(lexer);
+  if(!node && !lexer->failed) parse_error("type", lexer);
+  return node;
+}
+
+static node_t *gen_id_type(lexer_t *lexer) {
+  ulong pos = lexer_tell(lexer);
+  ulong mark = arena_mark(&node_arena);
+  node_t *kids[1];
+  if(!(kids[0] = parse_id(0, lexer))) goto fail;
+  return node_build(12, kids, 1);
+fail:
+  node_rewind(mark);
+  lexer_seek(lexer, pos);
+  return 0;
+}
+
+static node_t *gen_43(lexer_t *lexer) {
+  node_t *node = gen_match(lexer, TOK_OP, 10, 31);
+  if(!node && !lexer->failed) parse_error("}", lexer);
+  return node;
+}
+
+static node_t *gen_var_def(lexer_t *lexer) {
+  ulong pos = lexer_tell(lexer);
+  ulong mark = arena_mark(&node_arena);
+  node_t *kids[2];
+  if(!(kids[0] = gen_var(lexer))) goto fail;
+  if(!(gen_match(lexer, TOK_OP, 11, 40))) goto fail;
+  if(!(kids[1] = gen_exp(lexer))) goto fail;
+  if(!(gen_match(lexer, TOK_OP, 0, 39))) goto fail;
+  return node_build(2, kids, 2);
+fail:
+  node_rewind(mark);
+  lexer_seek(lexer, pos);
+  return 0;
+}
+
+static node_t *gen_var_decl(lexer_t *lexer) {
+  ulong pos = lexer_tell(lexer);
+  ulong mark = arena_mark(&node_arena);
+  node_t *kids[1];
+  if(!(gen_match(lexer, TOK_ID, 0, 44))) goto fail;
+  if(!(kids[0] = gen_49(lexer))) goto fail;
+  if(!(gen_50(lexer))) goto fail;
+  return node_build(6, kids, 1);
+fail:
+  node_rewind(mark);
+  lexer_seek(lexer, pos);
+  return 0;
+}
+
+static node_t *gen_49(lexer_t *lexer) {
+  node_t *node = gen_var(lexer);
+  if(!node && !lexer->failed) parse_error("variable declaration", lexer);
+  return node;
+}
+
+static node_t *gen_50(lexer_t *lexer) {
+  node_t *node = gen_match(lexer, TOK_OP, 0, 39);
+  if(!node && !lexer->failed) parse_error(";", lexer);
+  return node;
+}
+
+static node_t *gen_51(lexer_t *lexer) {
+  ulong pos = lexer_tell(lexer);
+  ulong mark = arena_mark(&node_arena);
+  node_t *res = 0;
+  node_t *prefix = parse_id(0, lexer);
+  if(!prefix) return 0;
+  switch(gen_class(lexer)) {
+    case TOK_ERR + 1 + 4: // (
+      if((res = gen_fun_decl(lexer))) {
+        return node_prepend(res, prefix);
+      }
+      if(lexer->failed) break;
+      if((res = gen_fun(lexer))) {
+        return node_prepend(res, prefix);
+      }
+      if(lexer->failed) break;
+      break;
+  }
+  node_rewind(mark);
+  lexer_seek(lexer, pos);
+  return 0;
+}
+
+static node_t *gen_fun_decl(lexer_t *lexer) {
+  ulong pos = lexer_tell(lexer);
+  ulong mark = arena_mark(&node_arena);
+  node_t *kids[1];
+  if(!(kids[0] = gen_fun_type(lexer))) goto fail;
+  if(!(gen_match(lexer, TOK_OP, 0, 39))) goto fail;
+  return node_build(10, kids, 1);
+fail:
+  node_rewind(mark);
+  lexer_seek(lexer, pos);
+  return 0;
+}
+
+static node_t *gen_fun(lexer_t *lexer) {
+  ulong pos = lexer_tell(lexer);
+  ulong mark = arena_mark(&node_arena);
+  node_t *kids[4];
+  if(!(gen_match(lexer, TOK_OP, 4, 32))) goto fail;
+  if(!(kids[0] = gen_param_list(lexer))) goto fail;
+  if(!(gen_match(lexer, TOK_OP, 5, 33))) goto fail;
+  if(!(gen_match(lexer, TOK_OP, 8, 36))) goto fail;
+  if(!(kids[1] = gen_type(lexer))) goto fail;
+  if(!(kids[2] = gen_var_def_list(lexer))) goto fail;
+  if(!(gen_match(lexer, TOK_OP, 1, 30))) goto fail;
+  if(!(kids[3] = gen_stm_list(lexer))) goto fail;
+  if(!(gen_match(lexer, TOK_OP, 10, 31))) goto fail;
+  return node_build(11, kids, 4);
+fail:
+  node_rewind(mark);
+  lexer_seek(lexer, pos);
+  return 0;
+}
+
+static node_t *gen_param_list(lexer_t *lexer) {
+  ulong base = gen_value_len;
+  node_t *node = 0;
+  while((node = gen_var(lexer))) {
+    gen_push(node);
+    if(!(node = gen_match(lexer, TOK_OP, 7, 37))) {
+      break;
+    }
+  }
+  if(lexer->failed) {
+    gen_value_len = base;
+    return 0;
+  }
+  node = node_build(9, gen_values + base, gen_value_len - base);
+  gen_value_len = base;
+  return node;
+}
+
+static node_t *gen_var_def_list(lexer_t *lexer) {
+  ulong base = gen_value_len;
+  node_t *node = 0;
+  while((node = gen_var_def(lexer))) {
+    gen_push(node);
+  }
+  if(lexer->failed) {
+    gen_value_len = base;
+    return 0;
+  }
+  node = node_build(3, gen_values + base, gen_value_len - base);
+  gen_value_len = base;
+  return node;
+}
+
+static node_t *gen_stm_list(lexer_t *lexer) {
+  ulong base = gen_value_len;
+  node_t *node = 0;
+  while((node = gen_stm(lexer))) {
+    gen_push(node);
+  }
+  if(lexer->failed) {
+    gen_value_len = base;
+    return 0;
+  }
+  node = node_build(22, gen_values + base, gen_value_len - base);
+  gen_value_len = base;
+  return node;
+}
+
+static node_t *gen_stm(lexer_t *lexer) {
+  ulong pos = lexer_tell(lexer);
+  node_t *res = 0;
+  switch(gen_class(lexer)) {
+    case TOK_EOF:
+    case TOK_OP:
+    case TOK_ERR:
+    case TOK_ERR + 1 + 1: // {
+    case TOK_ERR + 1 + 2: // :
+    case TOK_ERR + 1 + 3: // [
+    case TOK_ERR + 1 + 5: // )
+    case TOK_ERR + 1 + 6: // ]
+    case TOK_ERR + 1 + 7: // ,
+    case TOK_ERR + 1 + 8: // ->
+    case TOK_ERR + 1 + 9: // *
+    case TOK_ERR + 1 + 10: // }
+    case TOK_ERR + 1 + 11: // =
+    case TOK_ERR + 1 + 12: // 
+    case TOK_ERR + 1 + 13: // 
+    case TOK_ERR + 1 + 14: // 
+    case TOK_ERR + 1 + 15: // 
+    case TOK_ERR + 1 + 16: // 
+    case TOK_ERR + 1 + 17: // 
+    case TOK_ERR + 1 + 18: // 
+    case TOK_ERR + 1 + 19: // 
+    case TOK_ERR + 1 + 20: // 
+    case TOK_ERR + 1 + 21: // 
+    case TOK_ERR + 1 + 22: // 
+    case TOK_ERR + 1 + 23: // 
+    case TOK_ERR + 1 + 24: // 
+    case TOK_ERR + 1 + 25: // 
+    case TOK_ERR + 1 + 26: // 
+    case TOK_ERR + 1 + 27: // 
+    case TOK_ERR + 1 + 28: // 
+    case TOK_ERR + 1 + 29: // 
+    case TOK_ERR + 1 + 30: // 
+    case TOK_ERR + 1 + 31: // 
+    case TOK_ERR + 1 + 32: // 
+    case TOK_ERR + 1 + 33: // 
+    case TOK_ERR + 1 + 34: // 
+    case TOK_ERR + 1 + 35: // 
+    case TOK_ERR + 1 + 36: // 
+    case TOK_ERR + 1 + 37: // 
+    case TOK_ERR + 1 + 38: // 
+    case TOK_ERR + 1 + 39: // 
+    case TOK_ERR + 1 + 40: // 
+    case TOK_ERR + 1 + 41: // 
+    case TOK_ERR + 1 + 42: // 
+    case TOK_ERR + 1 + 43: // 
+    case TOK_ERR + 1 + 44: // 
+    case TOK_ERR + 1 + 45: // 
+    case TOK_ERR + 1 + 46: // 
+    case TOK_ERR + 1 + 47: // 
+    case TOK_ERR + 1 + 48: // 
+    case TOK_ERR + 1 + 49: // 
+    case TOK_ERR + 1 + 50: // 
+    case TOK_ERR + 1 + 51: // 
+    case TOK_ERR + 1 + 52: // 
+    case TOK_ERR + 1 + 53: // 
+    case TOK_ERR + 1 + 54: // 
+    case TOK_ERR + 1 + 55: // 
+      if((res = parse_skip(&(closure_env_t){ 0, 39, 0, -1 }, lexer))) {
+        return res;
+      }
+      lexer_seek(lexer, pos);
+      if(lexer->failed) break;
+      break;
+    case TOK_ID:
+      if((res = gen_exp_stm(lexer))) {
+        return res;
+      }
+      lexer_seek(lexer, pos);
+      if(lexer->failed) break;
+      if((res = gen_label_stm(lexer))) {
+        return res;
+      }
+      lexer_seek(lexer, pos);
+      if(lexer->failed) break;
+      if((res = gen_62(lexer))) {
+        return res;
+      }
+      lexer_seek(lexer, pos);
+      if(lexer->failed) break;
+      if((res = gen_ret_stm(lexer))) {
+        return res;
+      }
+      lexer_seek(lexer, pos);
+      if(lexer->failed) break;
+      if((res = parse_skip(&(closure_env_t){ 0, 39, 0, -1 }, lexer))) {
+        return res;
+      }
+      lexer_seek(lexer, pos);
+      if(lexer->failed) break;
+      break;
+    case TOK_INT:
+    case TOK_FLOAT:
+    case TOK_CHAR:
+    case TOK_STR:
+    case TOK_ERR + 1 + 4: // (
+      if((res = gen_exp_stm(lexer))) {
+        return res;
+      }
+      lexer_seek(lexer, pos);
+      if(lexer->failed) break;
+      if((res = parse_skip(&(closure_env_t){ 0, 39, 0, -1 }, lexer))) {
+        return res;
+      }
+      lexer_seek(lexer, pos);
+      if(lexer->failed) break;
+      break;
+    case TOK_ERR + 1 + 0: // ;
+      if((res = gen_match(lexer, TOK_OP, 0, 39))) {
+        return res;
+      }
+      lexer_seek(lexer, pos);
+      if(lexer->failed) break;
+      if((res = parse_skip(&(closure_env_t){ 0, 39, 0, -1 }, lexer))) {
+        return res;
+      }
+      lexer_seek(lexer, pos);
+      if(lexer->failed) break;
+      break;
+  }
+  return 0;
+}
+
+static node_t *gen_exp_stm(lexer_t *lexer) {
+  ulong pos = lexer_tell(lexer);
+  ulong mark = arena_mark(&node_arena);
+  node_t *kids[1];
+  if(!(kids[0] = gen_exp(lexer))) goto fail;
+  if(!(gen_match(lexer, TOK_OP, 0, 39))) goto fail;
+  return node_build(17, kids, 1);
+fail:
+  node_rewind(mark);
+  lexer_seek(lexer, pos);
+  return 0;
+}
+
+static node_t *gen_label_stm(lexer_t *lexer) {
+  ulong pos = lexer_tell(lexer);
+  ulong mark = arena_mark(&node_arena);
+  node_t *kids[1];
+  if(!(kids[0] = parse_id(0, lexer))) goto fail;
+  if(!(gen_match(lexer, TOK_OP, 2, 38))) goto fail;
+  return node_build(20, kids, 1);
+fail:
+  node_rewind(mark);
+  lexer_seek(lexer, pos);
+  return 0;
+}
+
+static node_t *gen_62(lexer_t *lexer) {
+  ulong pos = lexer_tell(lexer);
+  ulong mark = arena_mark(&node_arena);
+  node_t *res = 0;
+  node_t *prefix = gen_match(lexer, TOK_ID, 1, 42);
+  if(!prefix) return 0;
+  switch(gen_class(lexer)) {
+    case TOK_ID:
+      if((res = gen_jmp_stm(lexer))) {
+        return res;
+      }
+      if(lexer->failed) break;
+      if((res = gen_jmp_con_stm(lexer))) {
+        return res;
+      }
+      if(lexer->failed) break;
+      break;
+    case TOK_INT:
+    case TOK_FLOAT:
+    case TOK_CHAR:
+    case TOK_STR:
+    case TOK_ERR + 1 + 4: // (
+      if((res = gen_jmp_con_stm(lexer))) {
+        return res;
+      }
+      if(lexer->failed) break;
+      break;
+  }
+  node_rewind(mark);
+  lexer_seek(lexer, pos);
+  return 0;
+}
+
+static node_t *gen_jmp_stm(lexer_t *lexer) {
+  ulong pos = lexer_tell(lexer);
+  ulong mark = arena_mark(&node_arena);
+  node_t *kids[1];
+  if(!(kids[0] = parse_id(0, lexer))) goto fail;
+  if(!(gen_match(lexer, TOK_OP, 0, 39))) goto fail;
+  return node_build(18, kids, 1);
+fail:
+  node_rewind(mark);
+  lexer_seek(lexer, pos);
+  return 0;
+}
+
+static node_t *gen_jmp_con_stm(lexer_t *lexer) {
+  ulong pos = lexer_tell(lexer);
+  ulong mark = arena_mark(&node_arena);
+  node_t *kids[2];
+  if(!(kids[0] = gen_exp(lexer))) goto fail;
+  if(!(kids[1] = parse_id(0, lexer))) goto fail;
+  if(!(gen_match(lexer, TOK_OP, 0, 39))) goto fail;
+  return node_build(19, kids, 2);
+fail:
+  node_rewind(mark);
+  lexer_seek(lexer, pos);
+  return 0;
+}
+
+static node_t *gen_ret_stm(lexer_t *lexer) {
+  ulong pos = lexer_tell(lexer);
+  ulong mark = arena_mark(&node_arena);
+  node_t *kids[1];
+  if(!(gen_match(lexer, TOK_ID, 2, 43))) goto fail;
+  if(!(kids[0] = gen_exp(lexer))) goto fail;
+  if(!(gen_match(lexer, TOK_OP, 0, 39))) goto fail;
+  return node_build(21, kids, 1);
+fail:
+  node_rewind(mark);
+  lexer_seek(lexer, pos);
+  return 0;
+}
+
+void gen_parser_init(lexer_t *lexer) {
+  if(lexer_add_op(lexer, ";") != 0) panic("generated parser out of date");
+  if(lexer_add_op(lexer, "{") != 1) panic("generated parser out of date");
+  if(lexer_add_op(lexer, ":") != 2) panic("generated parser out of date");
+  if(lexer_add_op(lexer, "[") != 3) panic("generated parser out of date");
+  if(lexer_add_op(lexer, "(") != 4) panic("generated parser out of date");
+  if(lexer_add_op(lexer, ")") != 5) panic("generated parser out of date");
+  if(lexer_add_op(lexer, "]") != 6) panic("generated parser out of date");
+  if(lexer_add_op(lexer, ",") != 7) panic("generated parser out of date");
+  if(lexer_add_op(lexer, "->") != 8) panic("generated parser out of date");
+  if(lexer_add_op(lexer, "*") != 9) panic("generated parser out of date");
+  if(lexer_add_op(lexer, "}") != 10) panic("generated parser out of date");
+  if(lexer_add_op(lexer, "=") != 11) panic("generated parser out of date");
+  if(lexer_add_key(lexer, "extern") != 0) panic("generated parser out of date");
+  if(lexer_add_key(lexer, "jmp") != 1) panic("generated parser out of date");
+  if(lexer_add_key(lexer, "ret") != 2) panic("generated parser out of date");
+}
+
+node_t *gen_parse(lexer_t *lexer) {
+  return gen_base(lexer);
+}
@@ -1,8 +1,27 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <limits.h>
 #include <stdarg.h>
 #include <string.h>
+#include <math.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+#ifdef PROFILE_PARSER
+#include <time.h>
+#endif
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 //---------------------------------------
 // DEFINITIONS
@@ -10,7 +29,16 @@
 
 #define MAX_STR_LEN 1024
 
-#define IGNORE_SET " \n\r\t"
+#define INPUT_RING_SIZE 65536
+
+#define MEMO_SIZE 1024
+
+#define INTERN_SIZE 1024
+
+#define ARENA_CHUNK_SIZE 65536
+
+#define OUTPUT_BUFFER_SIZE (1 << 20)
+#define WATCH_POLL_MS 250
 
 //typedef size_t uint;
 typedef long unsigned int ulong;
@@ -59,14 +87,108 @@ typedef void (*free_f)(void*);
   exit(-1);                            \
 }
 
+// -- MEMORY ----------------------------
+
+// every block from alloc carries its size in front of it, so the heap
+// bytes held are known at any time. the objects are counted by their
+// constructors | see --mem-report
+
+#define MEM_HEAD 16  // keeps the blocks 16 byte aligned
+
+#define MEM_PARSE 0
+#define MEM_EMIT  1
+
+typedef enum mem_e {
+  MEM_NODE,
+  MEM_STR,
+  MEM_COMB,
+  MEM_STACK,
+  MEM_COUNT
+} mem_e;
+
+// nodes and strings are released with their arena | what they hold is
+// the mark of the arena, sampled before every reset
+typedef struct mem_kind_t {
+  ulong made, bytes;  // objects | their bytes so far
+  ulong held, peak;   // bytes held now | at most
+} mem_kind_t;
+
+typedef struct mem_t {
+  ulong live, peak;    // heap bytes
+  int   phase;         // MEM_PARSE | MEM_EMIT
+  ulong phase_peak[2];
+  ulong wasted;        // tree bytes dropped with failed alternatives
+  mem_kind_t kinds[MEM_COUNT];
+} mem_t;
+
+mem_t mem = { 0 };
+
+void mem_add(ulong size) {
+  mem.live += size;
+  if(mem.live > mem.peak) mem.peak = mem.live;
+  if(mem.live > mem.phase_peak[mem.phase]) mem.phase_peak[mem.phase] = mem.live;
+}
+
+// count objects of kind made | size is their total bytes
+void mem_made(mem_e kind, ulong count, ulong size) {
+  mem.kinds[kind].made  += count;
+  mem.kinds[kind].bytes += size;
+}
+
+// kind holds bytes now
+void mem_held(mem_e kind, ulong bytes) {
+  mem_kind_t *k = &mem.kinds[kind];
+  k->held = bytes;
+  if(k->held > k->peak) k->peak = k->held;
+}
+
+// objects on the heap | counted one by one
+void mem_new(mem_e kind, ulong size) {
+  mem_made(kind, 1, size);
+  mem_held(kind, mem.kinds[kind].held + size);
+}
+
+void mem_gone(mem_e kind, ulong size) {
+  mem_held(kind, mem.kinds[kind].held - size);
+}
+
 void *alloc(size_t size) {
-  void *res = malloc(size);
+  char *res = malloc(size + MEM_HEAD);
   if(!res) panic("unable to allocate %lu bytes", size);
-  return res;
+  *(size_t*)res = size;
+  mem_add(size);
+  return res + MEM_HEAD;
+}
+
+// data from alloc with size bytes | 0 allocates
+void *resize(void *data, size_t size) {
+  if(!data) return alloc(size);
+  char *head = (char*)data - MEM_HEAD;
+  size_t old = *(size_t*)head;
+  head = realloc(head, size + MEM_HEAD);
+  if(!head) panic("unable to allocate %lu bytes", size);
+  *(size_t*)head = size;
+  mem.live -= old;
+  mem_add(size);
+  return head + MEM_HEAD;
+}
+
+void dealloc(void *data) {
+  if(!data) return;
+  char *head = (char*)data - MEM_HEAD;
+  mem.live -= *(size_t*)head;
+  free(head);
 }
 
 void nop_free(void *obj) {}
 
+// makes room for one more element in a growable array
+void *grow(void *data, ulong *cap, ulong len, size_t size) {
+  if(len < *cap) return data;
+  *cap = *cap ? *cap * 2 : 64;
+  return resize(data, *cap * size);
+}
+
 //---------------------------------------
 // STACK 
 //---------------------------------------
@@ -78,6 +200,7 @@ typedef struct stack_t {
 
 stack_t *stack_new(void *obj) {
   stack_t *res = alloc(sizeof(stack_t));
+  mem_new(MEM_STACK, sizeof(stack_t));
   res->obj  = obj;
   res->next = 0;
   return res;
@@ -89,6 +212,7 @@ void stack_push(stack_t **this, void *obj) {
     return;
   }
   stack_t *s = alloc(sizeof(stack_t));
+  mem_new(MEM_STACK, sizeof(stack_t));
   s->obj  = obj;
   s->next = *this;
   *this = s;
@@ -99,7 +223,8 @@ void *stack_pop(stack_t **this) {
   stack_t *f = *this;
   void *res = (*this)->obj;
   *this = (*this)->next;
-  free(f);
+  dealloc(f);
+  mem_gone(MEM_STACK, sizeof(stack_t));
   return res;
 }
 
@@ -141,99 +266,492 @@ void stack_free(stack_t **stack, void(*free_f)(void*)) {
   for(void *obj = 0; (obj = stack_pop(stack)); free_f(obj));
 }
 
+//---------------------------------------
+// ARENA
+//---------------------------------------
+
+// bump allocator | nothing is freed on its own, the arena is reset to
+// a mark instead. a mark counts the bytes handed out before it, so the
+// chunks above a mark are found by their base. they are kept for reuse
+
+typedef struct arena_chunk_t {
+  struct arena_chunk_t *prev;
+  ulong base;  // bytes in the chunks before this one
+  ulong len, cap;
+  char  data[];
+} arena_chunk_t;
+
+typedef struct arena_t {
+  arena_chunk_t *chunk;  // current | the others follow prev
+  arena_chunk_t *spare;  // released by a reset
+} arena_t;
+
+void *arena_alloc(arena_t *this, size_t size) {
+  size = (size + 15) & ~(size_t)15;
+  arena_chunk_t *chunk = this->chunk;
+  if(!chunk || chunk->len + size > chunk->cap) {
+    ulong base = chunk ? chunk->base + chunk->len : 0;
+    arena_chunk_t *next = this->spare;
+    if(next && next->cap >= size) {
+      this->spare = next->prev;
+    } else {
+      ulong cap = size > ARENA_CHUNK_SIZE ? size : ARENA_CHUNK_SIZE;
+      next = alloc(sizeof(arena_chunk_t) + cap);
+      next->cap = cap;
+    }
+    next->prev = chunk;
+    next->base = base;
+    next->len  = 0;
+    this->chunk = chunk = next;
+  }
+  void *res = chunk->data + chunk->len;
+  chunk->len += size;
+  return res;
+}
+
+ulong arena_mark(arena_t *this) {
+  return this->chunk ? this->chunk->base + this->chunk->len : 0;
+}
+
+// releases everything allocated after mark
+void arena_reset(arena_t *this, ulong mark) {
+  while(this->chunk && this->chunk->base > mark) {
+    arena_chunk_t *chunk = this->chunk;
+    this->chunk = chunk->prev;
+    chunk->prev = this->spare;
+    this->spare = chunk;
+  }
+  if(this->chunk) this->chunk->len = mark - this->chunk->base;
+}
+
+void arena_free(arena_t *this) {
+  arena_reset(this, 0);
+  if(this->chunk) this->chunk->prev = this->spare;
+  else            this->chunk = this->spare;
+  for(arena_chunk_t *prev = 0; this->chunk; this->chunk = prev) {
+    prev = this->chunk->prev;
+    dealloc(this->chunk);
+  }
+  this->spare = 0;
+}
+
+//---------------------------------------
+// CHAR_UTIL 
+//---------------------------------------
+
+#define CC_SPACE 1
+#define CC_NUM   2
+#define CC_ALPHA 4
+#define CC_STR   8
+
+// class bits of every byte value
+const unsigned char char_class[256] = {
+  [32 ... 126] = CC_STR,
+  ['0' ... '9'] = CC_NUM | CC_STR,
+  ['a' ... 'z'] = CC_ALPHA | CC_STR,
+  ['A' ... 'Z'] = CC_ALPHA | CC_STR,
+  ['_']  = CC_ALPHA | CC_STR,
+  [' ']  = CC_SPACE | CC_STR,
+  ['\n'] = CC_SPACE,
+  ['\r'] = CC_SPACE,
+  ['\t'] = CC_SPACE
+};
+
+#define char_is(c, cc) (char_class[(unsigned char)(c)] & (cc))
+
+// checks if char is ' ' | \n | \r | \t
+int is_space(char _c) {
+  return char_is(_c, CC_SPACE);
+}
+
+// checks if char is 0 .. 9
+int is_num(char _c) {
+  return char_is(_c, CC_NUM);
+}
+
+// checks if char is a .. z | A .. Z | _
+int is_alpha(char _c) {
+  return char_is(_c, CC_ALPHA);
+}
+
+// checks if char is a .. z | A .. Z | 0 .. 9 | _
+int is_alpha_num(char _c) {
+  return char_is(_c, CC_ALPHA | CC_NUM);
+}
+
+// checks if char is valid str char
+int is_str(char _c) {
+  return char_is(_c, CC_STR);
+}
+
+// -- SCANNERS --------------------------
+
+// each scanner returns the length of the run of
+// matching chars at the start of p[0 .. n)
+// the simd paths handle 32 | 16 bytes per step and
+// leave the rest to the table driven scalar loop
+
+typedef ulong (*scan_f)(const char*, ulong);
+
+ulong scan_class(const char *p, ulong n, int cc) {
+  ulong i = 0;
+  for(; i < n && char_is(p[i], cc); i++);
+  return i;
+}
+
+ulong scan_space_scalar(const char *p, ulong n) {
+  return scan_class(p, n, CC_SPACE);
+}
+
+ulong scan_num_scalar(const char *p, ulong n) {
+  return scan_class(p, n, CC_NUM);
+}
+
+ulong scan_alpha_num_scalar(const char *p, ulong n) {
+  return scan_class(p, n, CC_ALPHA | CC_NUM);
+}
+
+#if defined(__AVX2__)
+
+#define avx_set(c)           _mm256_set1_epi8(c)
+#define avx_eq(x, c)         _mm256_cmpeq_epi8(x, avx_set(c))
+#define avx_range(x, lo, hi) _mm256_and_si256(_mm256_cmpgt_epi8(x, avx_set((lo) - 1)), \
+                                              _mm256_cmpgt_epi8(avx_set((hi) + 1), x))
+
+__m256i avx_space(__m256i x) {
+  return _mm256_or_si256(_mm256_or_si256(avx_eq(x, ' '), avx_eq(x, '\n')),
+                         _mm256_or_si256(avx_eq(x, '\r'), avx_eq(x, '\t')));
+}
+
+__m256i avx_num(__m256i x) {
+  return avx_range(x, '0', '9');
+}
+
+__m256i avx_alpha_num(__m256i x) {
+  __m256i l = _mm256_or_si256(x, avx_set(0x20));
+  return _mm256_or_si256(_mm256_or_si256(avx_range(l, 'a', 'z'), avx_range(x, '0', '9')),
+                         avx_eq(x, '_'));
+}
+
+#define avx_scan(p, n, i, match) \
+  for(; i + 32 <= n; i += 32) {                                                     \
+    uint32_t m = ~(uint32_t)_mm256_movemask_epi8(match(_mm256_loadu_si256((const __m256i*)(p + i)))); \
+    if(m) return i + __builtin_ctz(m);                                              \
+  }
+
+#else
+
+#define avx_scan(p, n, i, match)
+
+#endif
+
+#if defined(__SSE2__)
+
+#define sse_set(c)           _mm_set1_epi8(c)
+#define sse_eq(x, c)         _mm_cmpeq_epi8(x, sse_set(c))
+#define sse_range(x, lo, hi) _mm_and_si128(_mm_cmpgt_epi8(x, sse_set((lo) - 1)), \
+                                           _mm_cmplt_epi8(x, sse_set((hi) + 1)))
+
+__m128i sse_space(__m128i x) {
+  return _mm_or_si128(_mm_or_si128(sse_eq(x, ' '), sse_eq(x, '\n')),
+                      _mm_or_si128(sse_eq(x, '\r'), sse_eq(x, '\t')));
+}
+
+__m128i sse_num(__m128i x) {
+  return sse_range(x, '0', '9');
+}
+
+__m128i sse_alpha_num(__m128i x) {
+  __m128i l = _mm_or_si128(x, sse_set(0x20));
+  return _mm_or_si128(_mm_or_si128(sse_range(l, 'a', 'z'), sse_range(x, '0', '9')),
+                      sse_eq(x, '_'));
+}
+
+#define sse_scan(p, n, i, match) \
+  for(; i + 16 <= n; i += 16) {                                                     \
+    uint32_t m = ~(uint32_t)_mm_movemask_epi8(match(_mm_loadu_si128((const __m128i*)(p + i)))) & 0xffff; \
+    if(m) return i + __builtin_ctz(m);                                              \
+  }
+
+#else
+
+#define sse_scan(p, n, i, match)
+
+#endif
+
+ulong scan_space(const char *p, ulong n) {
+  ulong i = 0;
+  avx_scan(p, n, i, avx_space);
+  sse_scan(p, n, i, sse_space);
+  return i + scan_space_scalar(p + i, n - i);
+}
+
+ulong scan_num(const char *p, ulong n) {
+  ulong i = 0;
+  avx_scan(p, n, i, avx_num);
+  sse_scan(p, n, i, sse_num);
+  return i + scan_num_scalar(p + i, n - i);
+}
+
+ulong scan_alpha_num(const char *p, ulong n) {
+  ulong i = 0;
+  avx_scan(p, n, i, avx_alpha_num);
+  sse_scan(p, n, i, sse_alpha_num);
+  return i + scan_alpha_num_scalar(p + i, n - i);
+}
+
 //---------------------------------------
 // INPUT
 //---------------------------------------
 
+// regular files are mapped into memory as a whole
+// anything else (stdin, pipes) is streamed through a ring buffer
+// that holds everything from the last committed offset onwards,
+// so the parser can still restore any position inside the current
+// top-level item. the ring only grows if a single item outgrows it.
+
 typedef struct input_t {
-  FILE *file;
-  int is_std;
+  char  *data;
+  ulong len;    // bytes available | for streams: bytes read so far
+  ulong pos;
+  int   is_map;
+  // -- STREAM
+  FILE  *stream;
+  ulong cap;    // ring size (power of 2)
+  ulong base;   // offset of the oldest byte still held in the ring
+  int   eof;
+  // -- LINES
+  int   line_on;
+  ulong *lines; // offsets of the newlines in front of line_end
+  ulong line_len, line_cap;
+  ulong line_end;
 } input_t;
 
 input_t *input_new(FILE *file) {
   input_t *res = alloc(sizeof(input_t));
-  if(!file) {
-    res->file = stdin;
-    res->is_std = 1;
-  } else {
-    res->file = file;
-    res->is_std = 0;
+  memset(res, 0, sizeof(input_t));
+  if(!file) file = stdin;
+  struct stat st;
+  if(!fstat(fileno(file), &st) && S_ISREG(st.st_mode) && st.st_size > 0) {
+    void *map = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fileno(file), 0);
+    if(map != MAP_FAILED) {
+      res->data   = map;
+      res->len    = st.st_size;
+      res->is_map = 1;
+      if(file != stdin && fclose(file) == EOF) error("unable to close input stream");
+      return res;
+    }
   }
+  res->stream = file;
+  res->cap    = INPUT_RING_SIZE;
+  res->data   = alloc(res->cap);
   return res;
 }
 
 void input_free(input_t *this) {
   if(!this) return;
-  if(!this->is_std) {
-    if(fclose(this->file) == EOF) error("unable to close input stream");
+  if(this->is_map) {
+    if(munmap(this->data, this->len)) error("unable to unmap input");
+  } else {
+    if(this->stream != stdin && fclose(this->stream) == EOF) {
+      error("unable to close input stream");
+    }
+    dealloc(this->data);
+  }
+  dealloc(this->lines);
+  dealloc(this);
+}
+
+// doubles the ring, keeping the held bytes at their offsets
+void input_grow(input_t *this) {
+  char *data = alloc(this->cap * 2);
+  for(ulong i = this->base; i < this->len; i++) {
+    data[i & (this->cap * 2 - 1)] = this->data[i & (this->cap - 1)];
+  }
+  dealloc(this->data);
+  this->data = data;
+  this->cap *= 2;
+}
+
+// reads from the stream until offset is available
+// returns 0 if the stream ends before that
+int input_fill(input_t *this, ulong offset) {
+  if(!this->stream) return 0;
+  while(offset >= this->len) {
+    if(this->eof) return 0;
+    if(this->len - this->base == this->cap) input_grow(this);
+    ulong w = this->len & (this->cap - 1);
+    ulong n = this->cap - (this->len - this->base);
+    if(n > this->cap - w) n = this->cap - w;
+    ssize_t r = read(fileno(this->stream), this->data + w, n);
+    if(r < 0) panic("unable to read input stream");
+    if(r == 0) this->eof = 1;
+    this->len += r;
   }
-  free(this);
+  return 1;
+}
+
+char input_at(input_t *this, ulong offset) {
+  if(offset >= this->len && !input_fill(this, offset)) return (char)0;
+  if(this->is_map) return this->data[offset];
+  if(offset < this->base) panic("unable to rewind to committed offset %lu", offset);
+  return this->data[offset & (this->cap - 1)];
+}
+
+void input_index(input_t *this, ulong offset);
+
+// releases everything in front of offset
+// nothing before this point can be read afterwards
+void input_commit(input_t *this, ulong offset) {
+  if(this->is_map) return;
+  // the newlines have to be found before the bytes are gone
+  if(this->line_on) input_index(this, offset);
+  this->base = offset < this->len ? offset : this->len;
+}
+
+ulong input_tell(input_t *this) {
+  return this->pos;
+}
+
+void input_seek(input_t *this, ulong pos) {
+  this->pos = pos;
 }
 
 char input_next(input_t *this) {
-  int c = fgetc(this->file); 
-  if(c == EOF) {
+  char c = input_at(this, this->pos);
+  if(!c) {
     log("end of file");
     return (char)0;
   }
-  return (char)c;
+  this->pos++;
+  return c;
+}
+
+char input_peek(input_t *this) {
+  return input_at(this, this->pos);
 }
 
-void input_rewind(input_t *this, ulong n) {
-  if(fseek(this->file, (long int)-n, SEEK_CUR)) {
-    panic("unable to rewind %lu chars", n);
+// the contiguous bytes available at offset | 0 at the end of the input
+char *input_span(input_t *this, ulong offset, ulong *n) {
+  *n = 0;
+  if(offset >= this->len && !input_fill(this, offset)) return 0;
+  if(this->is_map) {
+    *n = this->len - offset;
+    return this->data + offset;
   }
+  if(offset < this->base) panic("unable to rewind to committed offset %lu", offset);
+  ulong i = offset & (this->cap - 1);
+  *n = this->len - offset;
+  if(*n > this->cap - i) *n = this->cap - i;
+  return this->data + i;
 }
 
-char input_peek(input_t *this) {
-  char c = input_next(this);
-  input_rewind(this, 1);
-  return c;
+// moves the cursor over the run of chars accepted by scan
+void input_scan(input_t *this, scan_f scan) {
+  ulong n = 0;
+  for(char *p = 0; (p = input_span(this, this->pos, &n));) {
+    ulong k = scan(p, n);
+    this->pos += k;
+    if(k < n) return;
+  }
 }
 
-int input_skip(input_t *this) {
-  char c = 0;
-  int count = -1;
-  // 0 - normal | 1 - in line comment | 2 - in multiline comment
-  int state = 0; 
-  do {
-    c = input_next(this);
-    count++;
-    if(state == 1) {
-      if(c == '\n') { 
-        c = input_next(this);
-        count++;
-        state = 0;
-      }
-    } else if(state == 2) {
-      if(c == '*' && input_peek(this) == '/') {
-        c = (input_next(this), input_next(this));
-        count += 2;
-        state = 0;
+// moves the cursor onto the next c | the end of the input
+void input_find(input_t *this, char c) {
+  ulong n = 0;
+  for(char *p = 0; (p = input_span(this, this->pos, &n));) {
+    char *f = memchr(p, c, n);
+    if(f) {
+      this->pos += f - p;
+      return;
+    }
+    this->pos += n;
+  }
+}
+
+// skips whitespace and comments | runs of whitespace with scan_space
+void input_skip_with(input_t *this, scan_f scan_space) {
+  for(;;) {
+    input_scan(this, scan_space);
+    if(input_peek(this) != '/') return;
+    char c = input_at(this, this->pos + 1);
+    if(c == '/') {
+      input_find(this, '\n');
+    } else if(c == '*') {
+      // looks for the closing / | the * in front of it
+      // can not be the one of the opening /*
+      ulong start = this->pos += 2;
+      for(;; this->pos++) {
+        input_find(this, '/');
+        if(!input_peek(this)) return;
+        if(this->pos > start && input_at(this, this->pos - 1) == '*') break;
       }
+      this->pos++;
     } else {
-      if(c == '/') {
-        char p = input_peek(this);
-        if(p == '/') state = 1;
-        if(p == '*') { 
-          state = 2;
-          input_next(this);
-          count++;
-        }
-      }
+      return;
+    }
+  }
+}
+
+void input_skip(input_t *this) {
+  input_skip_with(this, scan_space);
+}
+
+// -- LINES -----------------------------
+
+// line numbers are only needed for #line directives. the newlines are
+// looked for on the first question about a line behind them, nothing
+// is counted while lexing
+
+void input_lines(input_t *this) {
+  this->line_on = 1;
+}
+
+// finds the newlines in front of offset
+void input_index(input_t *this, ulong offset) {
+  ulong n = 0;
+  for(char *p = 0; this->line_end < offset && (p = input_span(this, this->line_end, &n));) {
+    if(n > offset - this->line_end) n = offset - this->line_end;
+    for(char *f = p; (f = memchr(f, '\n', n - (f - p))); f++) {
+      this->lines = grow(this->lines, &this->line_cap, this->line_len, sizeof(ulong));
+      this->lines[this->line_len++] = this->line_end + (f - p);
     }
-  } while(c && (state || strchr(IGNORE_SET, c)));
-  if(c) input_rewind(this, 1);
-  return count;
+    this->line_end += n;
+  }
+}
+
+// line of the byte at offset | counted from 1
+ulong input_line(input_t *this, ulong offset) {
+  input_index(this, offset);
+  ulong lo = 0, hi = this->line_len;
+  while(lo < hi) {
+    ulong mid = (lo + hi) / 2;
+    if(this->lines[mid] < offset) lo = mid + 1;
+    else                          hi = mid;
+  }
+  return lo + 1;
 }
 
 //---------------------------------------
 // OUTPUT 
 //---------------------------------------
 
+// everything is appended to one buffer with memcpy and handed to the
+// file in OUTPUT_BUFFER_SIZE blocks. stdio passes writes this large
+// straight to the system, the file is only used for its descriptor
+// and to keep the order with whatever else goes to stdout
+
 typedef struct output_t {
-  FILE *file;
-  int is_std;
+  FILE  *file;
+  int   is_std;
+  char  *buf;
+  ulong len;
+  // #line directives | off without lines
+  input_t *lines;
+  char    *name;
+  // builtin calls stay macro calls | see PRELUDE
+  int      prelude;
+  uint64_t defined;  // macros written so far
 } output_t;
 
 output_t *output_new(FILE *file) {
@@ -245,166 +763,614 @@ output_t *output_new(FILE *file) {
     res->file = file;
     res->is_std = 0;
   }
+  res->buf = alloc(OUTPUT_BUFFER_SIZE);
+  res->len = 0;
+  res->lines   = 0;
+  res->name    = 0;
+  res->prelude = 0;
+  res->defined = 0;
   return res;
 }
 
+// emits #line directives that point into input | name is the file
+// they name
+void output_lines(output_t *this, input_t *input, char *name) {
+  input_lines(input);
+  this->lines = input;
+  this->name  = name;
+}
+
+void output_flush(output_t *this) {
+  if(this->len && fwrite(this->buf, 1, this->len, this->file) != this->len) {
+    error("unable to write output stream");
+  }
+  this->len = 0;
+}
+
 void output_free(output_t *this) {
   if(!this) return;
+  output_flush(this);
   if(!this->is_std) {
     if(fclose(this->file) == EOF) error("unable to close output stream");
+  } else {
+    fflush(this->file);
+  }
+  dealloc(this->buf);
+  dealloc(this);
+}
+
+void emit_n(output_t *this, const char *str, ulong n) {
+  if(this->len + n > OUTPUT_BUFFER_SIZE) {
+    output_flush(this);
+    // too large for the buffer | goes out as it is
+    if(n > OUTPUT_BUFFER_SIZE) {
+      if(fwrite(str, 1, n, this->file) != n) error("unable to write output stream");
+      return;
+    }
   }
-  free(this);
+  memcpy(this->buf + this->len, str, n);
+  this->len += n;
+}
+
+void emit_char(output_t *this, char c) {
+  if(this->len == OUTPUT_BUFFER_SIZE) output_flush(this);
+  this->buf[this->len++] = c;
 }
 
 void emit(output_t *this, char *str) {
-  fprintf(this->file, "%s", str);
+  emit_n(this, str, strlen(str));
 }
 
 void emit_line(output_t *this, char *str) {
-  fprintf(this->file, "%s\n", str);
+  emit(this, str);
+  emit_char(this, '\n');
 }
 
 void emitf(output_t *this, char *fmt, ...) {
+  char small[256];
   va_list args;
   va_start(args, fmt);
-  vfprintf(this->file, fmt, args);
+  int n = vsnprintf(small, sizeof(small), fmt, args);
   va_end(args);
+  if(n < 0) {
+    error("unable to format output");
+    return;
+  }
+  if((size_t)n < sizeof(small)) {
+    emit_n(this, small, n);
+    return;
+  }
+  char *large = alloc(n + 1);
+  va_start(args, fmt);
+  vsnprintf(large, n + 1, fmt, args);
+  va_end(args);
+  emit_n(this, large, n);
+  dealloc(large);
 }
 
-//---------------------------------------
-// CHAR_UTIL 
-//---------------------------------------
-
-// checks if char is 0 .. 9
-int is_num(char _c) {
-  return (_c >= '0' && _c <= '9');
-}
-
-// checks if char is a .. z | A .. Z | _
-int is_alpha(char _c) {
-  return ((_c >= 'a' && _c <= 'z') || (_c >= 'A' && _c <= 'Z') || _c == '_');
-}
-
-// checks if char is a .. z | A .. Z | 0 .. 9 | _
-int is_alpha_num(char _c) {
-  return ((_c >= 'a' && _c <= 'z') || (_c >= 'A' && _c <= 'Z') || (_c >= '0' && _c <= '9') || _c == '_');
+// same digits as printf("%d")
+void emit_int(output_t *this, int val) {
+  char digits[16];
+  int i = sizeof(digits);
+  unsigned int u = val < 0 ? -(unsigned int)val : (unsigned int)val;
+  do digits[--i] = '0' + u % 10; while((u /= 10));
+  if(val < 0) digits[--i] = '-';
+  emit_n(this, digits + i, sizeof(digits) - i);
 }
 
-// checks if char is valid str char
-int is_str(char _c) {
-  return (_c >= 32 && _c <= 126);
+// same digits as printf("%f") | values whose sixth decimal is not
+// safely rounded in a double, and nan and inf, go to printf
+void emit_float(output_t *this, double val) {
+  double abs   = val < 0 ? -val : val;
+  double scale = abs * 1e6;
+  if(!(scale < (double)(1ull << 40))) {
+    emitf(this, "%f", val);
+    return;
+  }
+  uint64_t fixed = (uint64_t)scale;
+  double rest = scale - fixed;
+  if(rest > 0.499 && rest < 0.501) {
+    emitf(this, "%f", val);
+    return;
+  }
+  fixed += rest > 0.5;
+  char digits[32];
+  int i = sizeof(digits);
+  for(int d = 0; d < 6; d++, fixed /= 10) digits[--i] = '0' + fixed % 10;
+  digits[--i] = '.';
+  do digits[--i] = '0' + fixed % 10; while((fixed /= 10));
+  if(signbit(val)) digits[--i] = '-';
+  emit_n(this, digits + i, sizeof(digits) - i);
 }
 
 //---------------------------------------
-// NODE_TYPE
+// LEXER 
 //---------------------------------------
 
-typedef struct node_t {
-  node_type type;
-  void      *node;
-  void (*free)(void*);
-} node_t;
-
-node_t *node_new(node_type type, void *node, void(*free)(void*)) {
-  node_t *res = alloc(sizeof(node_t));
-  res->type = type;
-  res->node = node;
-  res->free = free;
+// the source is turned into tokens once, on demand
+// the combinators only match tokens by index, so restoring a
+// position is resetting an integer and whitespace and comments
+// are skipped exactly once
+
+typedef enum token_e {
+  TOK_EOF,
+  TOK_ID,
+  TOK_INT,
+  TOK_FLOAT,
+  TOK_CHAR,
+  TOK_STR,
+  TOK_OP,
+  TOK_ERR
+} token_e;
+
+// token classes as bits for lookahead sets
+// every token kind has its class | every registered operator its own
+#define CLASS_ALL      (~0ull)
+#define CLASS_KIND(k)  (1ull << (k))
+#define CLASS_OP(sym)  (1ull << (TOK_ERR + 1 + (sym)))
+#define MAX_OP_COUNT   (64 - (TOK_ERR + 1))
+
+typedef struct token_t {
+  token_e kind;
+  int     sym;     // symbol of the registered operator | keyword | -1
+  ulong   offset;
+  ulong   len;
+  union {
+    long   ival;
+    double fval;
+    char   cval;
+    struct str_t *id;  // interned name | set by the first parse_id
+  };
+} token_t;
+
+// registered operators and keywords share one trie | node 0 is the
+// root, siblings are linked in a list. operators start with a symbol
+// char and keywords with a letter, so their paths never meet
+typedef struct trie_t {
+  char c;
+  int  sym;       // symbol of the string ending here | -1
+  int  child;     // 0 if none
+  int  sibling;   // 0 if none
+} trie_t;
+
+typedef struct lexer_t {
+  input_t *input;
+  token_t *toks;
+  ulong   base;    // index of toks[0]
+  ulong   len;     // index one past the last lexed token
+  ulong   cap;
+  ulong   pos;     // index of the current token
+  trie_t  *trie;
+  ulong   trie_len, trie_cap;
+  int     op_count, key_count;
+  char    *text;   // copies of tokens that wrap around the ring
+  ulong   text_cap;
+  // syntax errors
+  ulong   errors;  // reported so far
+  int     failed;  // 1 after a failed expect until the parser recovered
+} lexer_t;
+
+lexer_t *lexer_new(input_t *input) {
+  lexer_t *res = alloc(sizeof(lexer_t));
+  memset(res, 0, sizeof(lexer_t));
+  res->input = input;
+  res->cap   = 256;
+  res->toks  = alloc(res->cap * sizeof(token_t));
+  res->trie  = grow(res->trie, &res->trie_cap, res->trie_len++, sizeof(trie_t));
+  res->trie[0] = (trie_t){ 0, -1, 0, 0 };
   return res;
 }
 
-void node_free(node_t *this) {
+void lexer_free(lexer_t *this) {
   if(!this) return;
-  this->free(this->node);
-  free(this);
+  input_free(this->input);
+  dealloc(this->toks);
+  dealloc(this->trie);
+  dealloc(this->text);
+  dealloc(this);
 }
 
-void *node_unwrap(node_t *this) {
-  if(!this) return 0;
-  return this->node;
+void parse_report(lexer_t *lexer, ulong offset, char *msg, char *desc) {
+  fprintf(stdout, "|PARSER ERROR| byte %lu: %s%s\n", offset, msg, desc);
+  lexer->errors++;
 }
 
-void node_stack_free(stack_t *this) {
-  if(!this) return;
-  stack_free(&this, (free_f)node_free);
+// a broken token is reported once and lexed as TOK_ERR | no rule takes
+// it, so the parser skips the item it is in without a second report
+void lexer_error(lexer_t *this, token_t *tok, ulong offset, char *desc) {
+  if(tok->kind != TOK_ERR) parse_report(this, offset, "invalid ", desc);
+  tok->kind = TOK_ERR;
 }
 
-//---------------------------------------
-// PRIMATIVE_NODE_TYPES
-//---------------------------------------
-
-// -- STRING ----------------------------
-
-typedef struct str_t {
-  char *val;
-} str_t;
-
-str_t *str_new(char *str) {
-  str_t *res = alloc(sizeof(str_t));
-  res->val = alloc(strlen(str));
-  strcpy(res->val, str);
-  return res;
+// child of node for c | 0 if none
+int trie_step(trie_t *trie, int node, char c) {
+  int n = trie[node].child;
+  while(n && trie[n].c != c) n = trie[n].sibling;
+  return n;
 }
 
-void str_free(str_t *this) {
-  if(!this) return;
-  free(this->val);
-  free(this);
+// node at the end of str | created if missing
+int lexer_trie_insert(lexer_t *this, char *str) {
+  int node = 0;
+  for(; *str; str++) {
+    int next = trie_step(this->trie, node, *str);
+    if(!next) {
+      this->trie = grow(this->trie, &this->trie_cap, this->trie_len, sizeof(trie_t));
+      next = this->trie_len++;
+      this->trie[next] = (trie_t){ *str, -1, 0, this->trie[node].child };
+      this->trie[node].child = next;
+    }
+    node = next;
+  }
+  return node;
 }
 
-// -- INTEGER ---------------------------
-
-typedef struct int_t {
-  int val;
-} int_t;
-
-int_t *int_new(int val) {
-  int_t *res = alloc(sizeof(int_t));
-  res->val = val;
-  return res;
+// registers an operator string | returns its symbol
+int lexer_add_op(lexer_t *this, char *op) {
+  int node = lexer_trie_insert(this, op);
+  if(this->trie[node].sym >= 0) return this->trie[node].sym;
+  if(this->op_count >= MAX_OP_COUNT) panic("too many operators");
+  return this->trie[node].sym = this->op_count++;
 }
 
-void int_free(int_t *this) {
-  if(!this) return;
-  free(this);
+// registers a keyword | returns its symbol
+int lexer_add_key(lexer_t *this, char *key) {
+  int node = lexer_trie_insert(this, key);
+  if(this->trie[node].sym >= 0) return this->trie[node].sym;
+  return this->trie[node].sym = this->key_count++;
 }
 
-// -- FLOAT -----------------------------
-
-typedef struct float_t {
-  double val;
-} float_t;
-
-float_t *float_new(double val) {
-  float_t *res = alloc(sizeof(float_t));
-  res->val = val;
-  return res;
+// the chars of a token range | points into the input unless the range
+// wraps around the ring, then into a copy that lives until the next call.
+// not terminated, except if terminate is set
+char *lexer_slice(lexer_t *this, ulong offset, ulong len, int terminate) {
+  ulong n = 0;
+  char *p = input_span(this->input, offset, &n);
+  if(p && n >= len && !terminate) return p;
+  while(len >= this->text_cap) this->text = grow(this->text, &this->text_cap, len, 1);
+  for(ulong i = 0; i < len; i++) this->text[i] = input_at(this->input, offset + i);
+  this->text[len] = 0;
+  return this->text;
 }
 
-void float_emit(float_t *this, output_t *out) {
-  emitf(out, "%lf", this->val);
+void lexer_lex_num(lexer_t *this, token_t *tok) {
+  input_t *in = this->input;
+  input_scan(in, scan_num);
+  ulong len = input_tell(in) - tok->offset;
+  tok->kind = TOK_INT;
+  if(input_peek(in) == 'f') {
+    input_next(in);
+    tok->kind = TOK_FLOAT;
+  } else if(input_peek(in) == '.') {
+    input_next(in);
+    input_scan(in, scan_num);
+    len = input_tell(in) - tok->offset;
+    tok->kind = TOK_FLOAT;
+  }
+  if(tok->kind == TOK_INT) {
+    // the digits are converted in place | like strtol, a number too big
+    // for a long is clamped to LONG_MAX
+    char *p = lexer_slice(this, tok->offset, len, 0);
+    ulong val = 0;
+    for(ulong i = 0; i < len && val < LONG_MAX; i++) {
+      ulong d = p[i] - '0';
+      val = val > (LONG_MAX - d) / 10 ? LONG_MAX : val * 10 + d;
+    }
+    tok->ival = val;
+  } else {
+    // strtod needs the end marked | 1.5e5 would be read as one number
+    tok->fval = strtod(lexer_slice(this, tok->offset, len, 1), 0);
+  }
 }
 
-void float_free(float_t *this) {
-  if(!this) return;
-  free(this);
+void lexer_lex_char(lexer_t *this, token_t *tok) {
+  input_t *in = this->input;
+  char c = 0;
+  tok->kind = TOK_CHAR;
+  input_next(in);
+  if((c = input_next(in)) == '\\') {
+    switch((c = input_next(in))) {
+      case 'n': c = '\n'; break;
+      case 't': c = '\t'; break;
+      case 'r': c = '\r'; break;
+      case '\'': c = '\''; break;
+      case '\\': c = '\\'; break;
+      default: lexer_error(this, tok, input_tell(in) - 2, "escape in char literal");
+    }
+  }
+  if(!c) {
+    lexer_error(this, tok, tok->offset, "char literal at end of file");
+    return;
+  }
+  if(input_peek(in) == '\'') {
+    input_next(in);
+    tok->cval = c;
+    return;
+  }
+  // the rest of a broken literal goes up to its quote or the line end
+  lexer_error(this, tok, input_tell(in), "char literal | \"'\" expected");
+  for(c = input_peek(in); c && c != '\'' && c != '\n'; c = input_peek(in)) input_next(in);
+  if(c == '\'') input_next(in);
 }
 
-// -- CHAR ------------------------------
+// a string with an invalid char goes on up to its quote or the line end
+void lexer_lex_str(lexer_t *this, token_t *tok) {
+  input_t *in = this->input;
+  char p = 0;
+  tok->kind = TOK_STR;
+  input_next(in);
+  for(char c = 0; (c = input_next(in)); p = c) {
+    if(c == '"') {
+      if(p == '\\') continue;
+      else return;
+    }
+    if(is_str(c)) continue;
+    lexer_error(this, tok, input_tell(in) - 1, "char inside string");
+    if(c == '\n') return;
+  }
+  lexer_error(this, tok, tok->offset, "string at end of file");
+}
+
+// keyword symbol of an identifier token | -1
+int lexer_lex_key(lexer_t *this, token_t *tok) {
+  int node = 0;
+  for(ulong i = 0; i < tok->len; i++) {
+    node = trie_step(this->trie, node, input_at(this->input, tok->offset + i));
+    if(!node) return -1;
+  }
+  return this->trie[node].sym;
+}
+
+// longest registered operator at the cursor | one walk down the trie
+void lexer_lex_op(lexer_t *this, token_t *tok) {
+  input_t *in = this->input;
+  ulong best = 0;
+  int node = 0;
+  for(ulong n = 1; (node = trie_step(this->trie, node, input_at(in, tok->offset + n - 1))); n++) {
+    if(this->trie[node].sym < 0) continue;
+    best = n;
+    tok->sym = this->trie[node].sym;
+  }
+  if(!best) best = 1;
+  tok->kind = TOK_OP;
+  if(tok->sym < 0) lexer_error(this, tok, tok->offset, "char");
+  input_seek(in, tok->offset + best);
+}
+
+void lexer_lex(lexer_t *this, token_t *tok) {
+  input_t *in = this->input;
+  input_skip(in);
+  tok->sym    = -1;
+  tok->offset = input_tell(in);
+  tok->ival   = 0;
+  char c = input_peek(in);
+  if(!c) {
+    tok->kind = TOK_EOF;
+  } else if(is_alpha(c)) {
+    input_scan(in, scan_alpha_num);
+    tok->kind = TOK_ID;
+    tok->len  = input_tell(in) - tok->offset;
+    tok->sym  = lexer_lex_key(this, tok);
+  } else if(is_num(c)) {
+    lexer_lex_num(this, tok);
+  } else if(c == '\'') {
+    lexer_lex_char(this, tok);
+  } else if(c == '"') {
+    lexer_lex_str(this, tok);
+  } else {
+    lexer_lex_op(this, tok);
+  }
+  tok->len = input_tell(in) - tok->offset;
+}
+
+// current token | lexed if not done yet
+token_t *lexer_peek(lexer_t *this) {
+  if(this->pos < this->len) return &this->toks[this->pos - this->base];
+  if(this->len - this->base == this->cap) {
+    this->cap *= 2;
+    this->toks = resize(this->toks, this->cap * sizeof(token_t));
+  }
+  lexer_lex(this, &this->toks[this->len - this->base]);
+  this->len++;
+  return &this->toks[this->pos - this->base];
+}
+
+token_t *lexer_next(lexer_t *this) {
+  token_t *tok = lexer_peek(this);
+  if(tok->kind != TOK_EOF) this->pos++;
+  return tok;
+}
+
+// class bit of the current token
+uint64_t lexer_class(lexer_t *this) {
+  token_t *tok = lexer_peek(this);
+  return tok->kind == TOK_OP ? CLASS_OP(tok->sym) : CLASS_KIND(tok->kind);
+}
+
+// byte offset of the token at index pos
+ulong lexer_offset(lexer_t *this, ulong pos) {
+  if(pos < this->len) return this->toks[pos - this->base].offset;
+  return input_tell(this->input);
+}
 
-typedef struct char_t {
-  char val;
-} char_t;
+ulong lexer_tell(lexer_t *this) {
+  return this->pos;
+}
 
-char_t *char_new(char val) {
-  char_t *res = alloc(sizeof(char_t));
-  res->val = val;
+void lexer_seek(lexer_t *this, ulong pos) {
+  this->pos = pos;
+}
+
+// drops all tokens in front of the current one
+void lexer_commit(lexer_t *this) {
+  ulong n = this->pos - this->base;
+  if(this->pos < this->len) {
+    input_commit(this->input, this->toks[n].offset);
+  } else {
+    input_commit(this->input, input_tell(this->input));
+  }
+  memmove(this->toks, this->toks + n, (this->len - this->pos) * sizeof(token_t));
+  this->base = this->pos;
+}
+
+//---------------------------------------
+// NODE_TYPE
+//---------------------------------------
+
+// a node is a fixed size record | leaves carry their value inline,
+// inner nodes point to their children, which are copied into one row
+// right behind the node when it is closed. the children are read in
+// order without chasing a list and the records of an item stay close.
+// every record of the item being parsed lives in node_arena. failed
+// alternatives are dropped by resetting to a mark and the item as a
+// whole once it is emitted
+
+arena_t node_arena = { 0, 0 };
+
+typedef struct node_t {
+  node_type type;
+  union {
+    uint32_t len;         // children
+    uint32_t pos;         // byte offset of the token of a primitive
+  };
+  union {
+    struct node_t *kids;  // inner nodes | len records in a row
+    struct str_t  *str;   // ID_NODE STR_NODE
+    int           ival;   // INT_NODE
+    double        fval;   // FLOAT_NODE
+    char          cval;   // CHAR_NODE
+  };
+} node_t;
+
+node_t *node_new(node_type type) {
+  node_t *res = arena_alloc(&node_arena, sizeof(node_t));
+  mem_made(MEM_NODE, 1, sizeof(node_t));
+  res->type = type;
+  res->len  = 0;
+  res->kids = 0;
   return res;
 }
 
-void char_free(char_t *this) {
-  if(!this) return;
-  free(this);
+// what node_arena holds | string literals included
+void node_held() {
+  mem_held(MEM_NODE, arena_mark(&node_arena));
+}
+
+// drops the nodes made after mark by a failed alternative
+void node_rewind(ulong mark) {
+  node_held();
+  mem.wasted += arena_mark(&node_arena) - mark;
+  arena_reset(&node_arena, mark);
+}
+
+// inner node of copies of the len nodes in kids
+node_t *node_build(node_type type, node_t **kids, ulong len) {
+  node_t *res = arena_alloc(&node_arena, (len + 1) * sizeof(node_t));
+  mem_made(MEM_NODE, len + 1, (len + 1) * sizeof(node_t));
+  res->type = type;
+  res->len  = len;
+  res->kids = res + 1;
+  for(ulong i = 0; i < len; i++) res->kids[i] = *kids[i];
+  return res;
+}
+
+// node with child in front of the children of this | this stays as it
+// is, so a node cached by packrat can be used again
+node_t *node_prepend(node_t *this, node_t *child) {
+  node_t *res = arena_alloc(&node_arena, (this->len + 2) * sizeof(node_t));
+  mem_made(MEM_NODE, this->len + 2, (this->len + 2) * sizeof(node_t));
+  res->type    = this->type;
+  res->len     = this->len + 1;
+  res->kids    = res + 1;
+  res->kids[0] = *child;
+  memcpy(res->kids + 1, this->kids, this->len * sizeof(node_t));
+  return res;
+}
+
+//---------------------------------------
+// PRIMATIVE_NODE_TYPES
+//---------------------------------------
+
+// ints, floats and chars are stored in the node itself
+
+// -- STRING ----------------------------
+
+typedef struct str_t {
+  char *val;
+  int  builtin;  // interned names: index + 1 in builtins | 0
+} str_t;
+
+// copy of the first len chars of str
+str_t *str_new(char *str, ulong len) {
+  str_t *res = arena_alloc(&node_arena, sizeof(str_t));
+  res->val = arena_alloc(&node_arena, len + 1);
+  mem_made(MEM_STR, 1, sizeof(str_t) + len + 1);
+  memcpy(res->val, str, len);
+  res->val[len] = 0;
+  res->builtin = 0;
+  return res;
+}
+
+// -- INTERN ----------------------------
+
+// every distinct identifier is stored once | id nodes of the same name
+// share one str_t, so names compare by pointer. the names outlive the
+// items and are kept in their own arena until the end of the run
+
+typedef struct intern_t {
+  str_t  **slots;
+  ulong  cap, count;
+  arena_t arena;
+} intern_t;
+
+intern_t intern_table = { 0, 0, 0, { 0, 0 } };
+
+ulong intern_hash(const char *str, ulong len) {
+  uint64_t h = 0xcbf29ce484222325ull;
+  for(ulong i = 0; i < len; i++) h = (h ^ (unsigned char)str[i]) * 0x100000001b3ull;
+  return h;
+}
+
+void intern_grow(intern_t *this) {
+  str_t **old = this->slots;
+  ulong old_cap = this->cap;
+  this->cap = old_cap ? old_cap * 2 : INTERN_SIZE;
+  this->slots = alloc(this->cap * sizeof(str_t*));
+  memset(this->slots, 0, this->cap * sizeof(str_t*));
+  for(ulong i = 0; i < old_cap; i++) {
+    if(!old[i]) continue;
+    ulong j = intern_hash(old[i]->val, strlen(old[i]->val)) & (this->cap - 1);
+    for(; this->slots[j]; j = (j + 1) & (this->cap - 1));
+    this->slots[j] = old[i];
+  }
+  dealloc(old);
+}
+
+// the unique str_t of the first len chars of str
+str_t *intern(char *str, ulong len) {
+  intern_t *this = &intern_table;
+  if((this->count + 1) * 2 > this->cap) intern_grow(this);
+  ulong i = intern_hash(str, len) & (this->cap - 1);
+  for(; this->slots[i]; i = (i + 1) & (this->cap - 1)) {
+    char *val = this->slots[i]->val;
+    if(!strncmp(val, str, len) && !val[len]) return this->slots[i];
+  }
+  str_t *res = arena_alloc(&this->arena, sizeof(str_t));
+  res->val = arena_alloc(&this->arena, len + 1);
+  mem_made(MEM_STR, 1, sizeof(str_t) + len + 1);
+  mem_held(MEM_STR, arena_mark(&this->arena));
+  memcpy(res->val, str, len);
+  res->val[len] = 0;
+  res->builtin = 0;
+  this->slots[i] = res;
+  this->count++;
+  return res;
+}
+
+void intern_free() {
+  dealloc(intern_table.slots);
+  arena_free(&intern_table.arena);
+  memset(&intern_table, 0, sizeof(intern_t));
 }
 
 //---------------------------------------
@@ -417,10 +1383,21 @@ typedef enum comb_e {
  COMB_OR,
  COMB_AND,
  COMB_OPT,
- COMB_EXPECT
+ COMB_EXPECT,
+ COMB_FACTOR
 } comb_e;
 
-typedef node_t*(*parse_f)(void*, input_t*, ulong*);
+typedef node_t*(*parse_f)(void*, lexer_t*);
+
+#ifdef PROFILE_PARSER
+// what parsing with a combinator cost | see --profile-parser
+typedef struct prof_t {
+  ulong  calls, hits, fails;
+  ulong  rewound;     // bytes given back on failure
+  ulong  dropped;     // node records freed on failure | nested ones too
+  double incl, excl;  // seconds with | without the children
+} prof_t;
+#endif
 
 typedef struct comb_t {
   comb_e type;
@@ -448,21 +1425,41 @@ typedef struct comb_t {
       struct comb_t *exp;
       char *desc;
     };
+    // -- FACTOR
+    struct {
+      struct comb_t *prefix;
+      // AND combinators with the rest of every alternative
+      stack_t *tails;
+    };
   };
   node_type n_type;
+  int drop;          // 1 if a sequence matches it without keeping its node
   int ref_count;
+  char *name;        // rule name in generated code | 0
+#ifdef PROFILE_PARSER
+  prof_t prof;
+#endif
+  // lookahead
+  uint64_t first;    // token classes it is able to start with
+  int      nullable; // 1 if it is able to succeed without a token
 } comb_t;
 
 comb_t *comb_new() {
   comb_t *res = alloc(sizeof(comb_t));
+  mem_new(MEM_COMB, sizeof(comb_t));
   memset(res, 0, sizeof(comb_t));
   res->ref_count = 1;
   return res;
 }
 
-void comb_error(comb_t *this, input_t *input) {
-  fprintf(stdout, "|PARSER ERROR| Expected: %s\n", this->desc);
-  exit(-1);
+// a failed expect | the parser gives up the current top-level item
+void parse_error(char *desc, lexer_t *lexer) {
+  parse_report(lexer, lexer_peek(lexer)->offset, "Expected: ", desc);
+  lexer->failed = 1;
+}
+
+void comb_error(comb_t *this, lexer_t *lexer) {
+  parse_error(this->desc, lexer);
 }
 
 comb_t *comb_share(comb_t *this) {
@@ -490,228 +1487,794 @@ void comb_free(comb_t *this) {
     case COMB_EXPECT:
       comb_free(this->exp);
       break;
+    case COMB_FACTOR:
+      comb_free(this->prefix);
+      stack_free(&this->tails, (free_f)comb_free);
+      break;
   }
-  free(this);
+  dealloc(this);
+  mem_gone(MEM_COMB, sizeof(comb_t));
 }
 
-node_t *comb_parse(input_t *input, comb_t *this, ulong *rcr) {
-  if(!this) return 0;
-  node_t     *res = 0;
-  stack_t    *stack = 0;
-  stack_t    *in_stack = this->stack;
-  comb_t     *comb_elem = 0;
-  ulong      rc = 0;
-  if(this->type == COMB_JUST) {
-    res = this->parse(this->env, input, &rc);
-  } else if(this->type == COMB_OR) {
-    while((comb_elem = stack_next(&in_stack))) {
-      if((res = comb_parse(input, comb_elem, &rc))) {
-        break;
+typedef void (*comb_walk_f)(comb_t*, void*);
+
+void comb_walk_rec(comb_t *this, comb_walk_f f, void *ctx, stack_t **seen) {
+  if(!this) return;
+  for(stack_t *s = *seen; s; s = s->next) {
+    if(s->obj == this) return;
+  }
+  stack_push(seen, this);
+  f(this, ctx);
+  switch(this->type) {
+    case COMB_NONE:
+    case COMB_JUST: 
+      break;
+    case COMB_OR:
+    case COMB_AND:
+      for(stack_t *s = this->stack; s; s = s->next) {
+        comb_walk_rec(s->obj, f, ctx, seen);
       }
-      input_rewind(input, rc);
-      rc = 0;
-    }
-  } else if(this->type == COMB_AND) {
-    while((comb_elem = stack_next(&in_stack))) {
-      if(!(res = comb_parse(input, comb_elem, &rc))) {
-        stack_free(&stack, (free_f)node_free); 
-        input_rewind(input, rc);
-        rc = 0;
-        return 0;
+      break;
+    case COMB_OPT:
+      comb_walk_rec(this->elem, f, ctx, seen);
+      comb_walk_rec(this->sep, f, ctx, seen);
+      break;
+    case COMB_EXPECT:
+      comb_walk_rec(this->exp, f, ctx, seen);
+      break;
+    case COMB_FACTOR:
+      comb_walk_rec(this->prefix, f, ctx, seen);
+      for(stack_t *s = this->tails; s; s = s->next) {
+        comb_walk_rec(s->obj, f, ctx, seen);
       }
-      stack_push(&stack, res);
+      break;
+  }
+}
+
+// calls f once for every combinator reachable from this
+void comb_walk(comb_t *this, comb_walk_f f, void *ctx) {
+  stack_t *seen = 0;
+  comb_walk_rec(this, f, ctx, &seen);
+  stack_free(&seen, nop_free);
+}
+
+//---------------------------------------
+// VM
+//---------------------------------------
+
+// the combinator graph lowered into a flat instruction array
+// every combinator except JUST becomes a subroutine | JUST
+// combinators match their token inline. one backtrack stack holds
+// return addresses and choice points (lpeg style), the nodes are
+// collected on a value stack and closed by BUILD
+
+typedef enum vm_op_e {
+  VM_CALL,    // calls the rule of comb
+  VM_RET,
+  VM_CHOICE,  // pushes a choice point resuming at arg
+  VM_COMMIT,  // drops the choice point | jumps to arg
+  VM_FAIL,
+  VM_TEST,    // jumps to arg if comb is not able to start with the next token
+  VM_MATCH,   // matches the JUST comb | pushes its node unless arg
+  VM_MARK,    // opens a node
+  VM_BUILD,   // closes the node as n_type arg
+  VM_DROP,    // discards the last node
+  VM_JMP,
+  VM_ERROR,   // EXPECT comb failed
+  VM_END
+} vm_op_e;
+
+typedef struct inst_t {
+  vm_op_e op;
+  int     arg;
+  comb_t  *comb;
+} inst_t;
+
+typedef struct vm_frame_t {
+  int   addr;     // return address | resume address of a choice point
+  int   choice;
+  ulong pos;
+  ulong values;
+  ulong marks;
+  ulong arena;    // node_arena mark | a failure drops the nodes above it
+} vm_frame_t;
+
+typedef struct vm_t {
+  inst_t     *code;
+  ulong      code_len, code_cap;
+  int        entry;
+  // rules
+  comb_t     **rules;
+  int        *rule_addr;
+  ulong      rule_len, rule_cap, addr_cap;
+  // runtime
+  vm_frame_t *frames;
+  ulong      frame_len, frame_cap;
+  node_t     **values;
+  ulong      value_len, value_cap;
+  ulong      *marks;
+  ulong      mark_len, mark_cap;
+} vm_t;
+
+int vm_emit(vm_t *this, vm_op_e op, int arg, comb_t *comb) {
+  this->code = grow(this->code, &this->code_cap, this->code_len, sizeof(inst_t));
+  this->code[this->code_len] = (inst_t){ op, arg, comb };
+  return this->code_len++;
+}
+
+// index of the rule of comb | queued for compilation if new
+int vm_rule(vm_t *this, comb_t *comb) {
+  for(ulong i = 0; i < this->rule_len; i++) {
+    if(this->rules[i] == comb) return i;
+  }
+  this->rules = grow(this->rules, &this->rule_cap, this->rule_len, sizeof(comb_t*));
+  this->rule_addr = grow(this->rule_addr, &this->addr_cap, this->rule_len, sizeof(int));
+  this->rules[this->rule_len] = comb;
+  this->rule_addr[this->rule_len] = -1;
+  return this->rule_len++;
+}
+
+void vm_emit_ref(vm_t *this, comb_t *comb) {
+  if(comb->type == COMB_JUST) vm_emit(this, VM_MATCH, 0, comb);
+  else                        vm_emit(this, VM_CALL, vm_rule(this, comb), comb);
+}
+
+// element of a sequence | a dropped one leaves no value behind
+void vm_emit_elem(vm_t *this, comb_t *comb) {
+  if(!comb->drop) {
+    vm_emit_ref(this, comb);
+  } else if(comb->type == COMB_JUST) {
+    vm_emit(this, VM_MATCH, 1, comb);
+  } else {
+    vm_emit_ref(this, comb);
+    vm_emit(this, VM_DROP, 0, comb);
+  }
+}
+
+void vm_compile_rule(vm_t *this, comb_t *comb) {
+  stack_t *s = comb->stack;
+  switch(comb->type) {
+    case COMB_NONE:
+      vm_emit(this, VM_FAIL, 0, comb);
+      break;
+    case COMB_JUST:
+      vm_emit_ref(this, comb);
+      vm_emit(this, VM_RET, 0, comb);
+      break;
+    case COMB_OR: {
+      // TEST next | CHOICE next | alt | COMMIT end | next: ... FAIL | end: RET
+      stack_t *commits = 0;
+      for(; s; s = s->next) {
+        int test = vm_emit(this, VM_TEST, 0, s->obj);
+        int choice = vm_emit(this, VM_CHOICE, 0, comb);
+        vm_emit_ref(this, s->obj);
+        stack_push(&commits, (void*)(intptr_t)vm_emit(this, VM_COMMIT, 0, comb));
+        this->code[test].arg = this->code[choice].arg = this->code_len;
+      }
+      vm_emit(this, VM_FAIL, 0, comb);
+      while(commits) this->code[(intptr_t)stack_pop(&commits)].arg = this->code_len;
+      vm_emit(this, VM_RET, 0, comb);
+      break;
     }
-    stack_inverse(&stack);
-    res = node_new(this->n_type, stack, (free_f)node_stack_free);
-  } else if(this->type == COMB_OPT) {
-    for(;;) {
-      if(!(res = comb_parse(input, this->elem, &rc))) {
-        break;
+    case COMB_AND:
+      vm_emit(this, VM_MARK, 0, comb);
+      for(; s; s = s->next) vm_emit_elem(this, s->obj);
+      vm_emit(this, VM_BUILD, comb->n_type, comb);
+      vm_emit(this, VM_RET, 0, comb);
+      break;
+    case COMB_OPT: {
+      // loop: CHOICE done | elem | COMMIT sep
+      // sep:  CHOICE done | sep | DROP | COMMIT loop    (sl == 0)
+      //       sep | DROP | JMP loop                     (sl == 1)
+      // done: BUILD | RET
+      vm_emit(this, VM_MARK, 0, comb);
+      int loop = this->code_len;
+      int choice = vm_emit(this, VM_CHOICE, 0, comb);
+      vm_emit_ref(this, comb->elem);
+      int commit = vm_emit(this, VM_COMMIT, loop, comb);
+      int sep_choice = -1;
+      if(comb->sep) {
+        this->code[commit].arg = this->code_len;
+        if(!comb->sl) sep_choice = vm_emit(this, VM_CHOICE, 0, comb);
+        vm_emit_ref(this, comb->sep);
+        vm_emit(this, VM_DROP, 0, comb);
+        vm_emit(this, comb->sl ? VM_JMP : VM_COMMIT, loop, comb);
       }
-      stack_push(&stack, res);
-      if(this->sep) {
-        if(!(res = comb_parse(input, this->sep, &rc))) {
-          if(this->sl) {
-            stack_free(&stack, (free_f)node_free);
-            input_rewind(input, rc);
-            rc = 0;
-            return 0;
-          } else {
-            break;
-          }
-        } else {
-          node_free(res);
-        } 
+      this->code[choice].arg = this->code_len;
+      if(sep_choice >= 0) this->code[sep_choice].arg = this->code_len;
+      vm_emit(this, VM_BUILD, comb->n_type, comb);
+      vm_emit(this, VM_RET, 0, comb);
+      break;
+    }
+    case COMB_FACTOR: {
+      // MARK | prefix
+      // TEST next | CHOICE next | tail... | BUILD | COMMIT end | next: ... FAIL
+      // end: RET
+      // the tails are inlined so BUILD closes the mark in front of prefix
+      stack_t *commits = 0;
+      vm_emit(this, VM_MARK, 0, comb);
+      vm_emit_elem(this, comb->prefix);
+      for(s = comb->tails; s; s = s->next) {
+        comb_t *tail = s->obj;
+        int test = vm_emit(this, VM_TEST, 0, tail);
+        int choice = vm_emit(this, VM_CHOICE, 0, comb);
+        for(stack_t *e = tail->stack; e; e = e->next) vm_emit_elem(this, e->obj);
+        vm_emit(this, VM_BUILD, tail->n_type, tail);
+        stack_push(&commits, (void*)(intptr_t)vm_emit(this, VM_COMMIT, 0, comb));
+        this->code[test].arg = this->code[choice].arg = this->code_len;
       }
+      vm_emit(this, VM_FAIL, 0, comb);
+      while(commits) this->code[(intptr_t)stack_pop(&commits)].arg = this->code_len;
+      vm_emit(this, VM_RET, 0, comb);
+      break;
     }
-    stack_inverse(&stack);
-    res = node_new(this->n_type, stack, (free_f)node_stack_free);
-  } else if(this->type == COMB_EXPECT) {
-    res = comb_parse(input, this->exp, &rc);
-    if(!res) {
-      comb_error(this, input);
+    case COMB_EXPECT: {
+      // CHOICE error | exp | COMMIT ret | error: ERROR | ret: RET
+      int choice = vm_emit(this, VM_CHOICE, 0, comb);
+      vm_emit_ref(this, comb->exp);
+      vm_emit(this, VM_COMMIT, this->code_len + 2, comb);
+      this->code[choice].arg = vm_emit(this, VM_ERROR, 0, comb);
+      vm_emit(this, VM_RET, 0, comb);
+      break;
     }
-  } else {
-    panic("undefined parser combinator");
   }
-  *rcr += rc;
+}
+
+// compiles every combinator reachable from base
+vm_t *vm_new(comb_t *base) {
+  vm_t *res = alloc(sizeof(vm_t));
+  memset(res, 0, sizeof(vm_t));
+  res->entry = vm_emit(res, VM_CALL, vm_rule(res, base), base);
+  vm_emit(res, VM_END, 0, base);
+  for(ulong i = 0; i < res->rule_len; i++) {
+    res->rule_addr[i] = res->code_len;
+    vm_compile_rule(res, res->rules[i]);
+  }
+  // rule indices to addresses
+  for(ulong i = 0; i < res->code_len; i++) {
+    if(res->code[i].op == VM_CALL) res->code[i].arg = res->rule_addr[res->code[i].arg];
+  }
   return res;
 }
 
+void vm_free(vm_t *this) {
+  if(!this) return;
+  dealloc(this->code);
+  dealloc(this->rules);
+  dealloc(this->rule_addr);
+  dealloc(this->frames);
+  dealloc(this->values);
+  dealloc(this->marks);
+  dealloc(this);
+}
+
+void vm_push_frame(vm_t *this, int addr, int choice, ulong pos) {
+  this->frames = grow(this->frames, &this->frame_cap, this->frame_len, sizeof(vm_frame_t));
+  this->frames[this->frame_len++] = (vm_frame_t){ addr, choice, pos, this->value_len, this->mark_len, arena_mark(&node_arena) };
+}
+
+void vm_push_value(vm_t *this, node_t *node) {
+  this->values = grow(this->values, &this->value_cap, this->value_len, sizeof(node_t*));
+  this->values[this->value_len++] = node;
+}
+
+
+node_t *vm_run(vm_t *this, lexer_t *lexer) {
+  ulong start = lexer_tell(lexer);
+  ulong mark  = arena_mark(&node_arena);
+  int pc = this->entry;
+  this->frame_len = this->value_len = this->mark_len = 0;
+  for(;;) {
+    inst_t *in = &this->code[pc];
+    switch(in->op) {
+      case VM_CALL:
+        vm_push_frame(this, pc + 1, 0, 0);
+        pc = in->arg;
+        continue;
+      case VM_RET:
+        pc = this->frames[--this->frame_len].addr;
+        continue;
+      case VM_CHOICE:
+        vm_push_frame(this, in->arg, 1, lexer_tell(lexer));
+        pc++;
+        continue;
+      case VM_COMMIT:
+        this->frame_len--;
+        pc = in->arg;
+        continue;
+      case VM_TEST:
+        if(!(in->comb->first & lexer_class(lexer)) && !in->comb->nullable) pc = in->arg;
+        else pc++;
+        continue;
+      case VM_MATCH: {
+        node_t *node = in->comb->parse(in->comb->env, lexer);
+        if(!node) break;
+        if(!in->arg) vm_push_value(this, node);
+        pc++;
+        continue;
+      }
+      case VM_MARK:
+        this->marks = grow(this->marks, &this->mark_cap, this->mark_len, sizeof(ulong));
+        this->marks[this->mark_len++] = this->value_len;
+        pc++;
+        continue;
+      case VM_BUILD: {
+        ulong mark = this->marks[--this->mark_len];
+        node_t *node = node_build(in->arg, this->values + mark, this->value_len - mark);
+        this->value_len = mark;
+        vm_push_value(this, node);
+        pc++;
+        continue;
+      }
+      case VM_DROP:
+        this->value_len--;
+        pc++;
+        continue;
+      case VM_JMP:
+        pc = in->arg;
+        continue;
+      case VM_FAIL:
+        break;
+      case VM_ERROR:
+        comb_error(in->comb, lexer);
+        node_rewind(mark);
+        lexer_seek(lexer, start);
+        return 0;
+      case VM_END:
+        return this->values[--this->value_len];
+    }
+    // fail | back to the last choice point
+    while(this->frame_len && !this->frames[this->frame_len - 1].choice) this->frame_len--;
+    if(!this->frame_len) {
+      node_rewind(mark);
+      lexer_seek(lexer, start);
+      return 0;
+    }
+    vm_frame_t *f = &this->frames[--this->frame_len];
+    lexer_seek(lexer, f->pos);
+    node_rewind(f->arena);
+    this->value_len = f->values;
+    this->mark_len = f->marks;
+    pc = f->addr;
+  }
+}
+
 //---------------------------------------
 // PARSER 
 //---------------------------------------
 
+// -- MEMO ------------------------------
+
+// packrat table | caches the result of a combinator at a token index
+// failures are cached as 0. nodes are not changed while the item is
+// parsed, so a cached node can be handed out any number of times.
+// the table only lives for one top-level item. a cached node may have
+// been built inside an alternative that failed later, so with a table
+// node_arena is only reset once the item is done
+
+typedef struct memo_entry_t {
+  comb_t *comb;
+  ulong  pos;
+  ulong  end;
+  node_t *res;
+} memo_entry_t;
+
+typedef struct memo_t {
+  memo_entry_t *entries;
+  ulong        cap;
+  ulong        count;
+} memo_t;
+
+memo_t *memo_new() {
+  memo_t *res = alloc(sizeof(memo_t));
+  res->cap     = MEMO_SIZE;
+  res->count   = 0;
+  res->entries = alloc(res->cap * sizeof(memo_entry_t));
+  memset(res->entries, 0, res->cap * sizeof(memo_entry_t));
+  return res;
+}
+
+void memo_clear(memo_t *this) {
+  if(!this->count) return;
+  for(ulong i = 0; i < this->cap; i++) {
+    this->entries[i].comb = 0;
+  }
+  this->count = 0;
+}
+
+void memo_free(memo_t *this) {
+  if(!this) return;
+  memo_clear(this);
+  dealloc(this->entries);
+  dealloc(this);
+}
+
+ulong memo_hash(memo_t *this, comb_t *comb, ulong pos) {
+  uint64_t h = ((uintptr_t)comb >> 4) ^ ((uint64_t)pos * 0x9e3779b97f4a7c15ull);
+  return (h ^ (h >> 29)) & (this->cap - 1);
+}
+
+memo_entry_t *memo_get(memo_t *this, comb_t *comb, ulong pos) {
+  for(ulong i = memo_hash(this, comb, pos);; i = (i + 1) & (this->cap - 1)) {
+    memo_entry_t *e = &this->entries[i];
+    if(!e->comb) return 0;
+    if(e->comb == comb && e->pos == pos) return e;
+  }
+}
+
+void memo_put(memo_t *this, comb_t *comb, ulong pos, ulong end, node_t *res) {
+  if((this->count + 1) * 2 > this->cap) {
+    memo_entry_t *old = this->entries;
+    ulong old_cap = this->cap;
+    this->cap *= 2;
+    this->entries = alloc(this->cap * sizeof(memo_entry_t));
+    memset(this->entries, 0, this->cap * sizeof(memo_entry_t));
+    this->count = 0;
+    for(ulong i = 0; i < old_cap; i++) {
+      if(old[i].comb) memo_put(this, old[i].comb, old[i].pos, old[i].end, old[i].res);
+    }
+    dealloc(old);
+  }
+  ulong i = memo_hash(this, comb, pos);
+  for(; this->entries[i].comb; i = (i + 1) & (this->cap - 1));
+  this->entries[i] = (memo_entry_t){ comb, pos, end, res };
+  this->count++;
+}
+
+// --  ----------------------------------
+
+typedef struct comb_frame_t {
+  comb_t  *comb;
+  ulong   pos;     // token index the combinator started at
+  stack_t *iter;   // next alternative | element
+  ulong   values;  // its children are parser->values from here on
+  ulong   mark;    // node_arena before the combinator started
+  int     state;   // OPT: 1 if the separator is next | FACTOR: 1 after the prefix
+#ifdef PROFILE_PARSER
+  double  start;   // when the frame was pushed
+  double  child;   // time spent in children
+#endif
+} comb_frame_t;
+
 typedef struct parser_t {
-  input_t *input;
-  comb_t  *base;
-  stack_t *comb_stack;
+  lexer_t      *lexer;
+  comb_t       *base;
+  stack_t      *comb_stack;
+  memo_t       *memo;     // packrat table | 0 if disabled
+  vm_t         *vm;       // compiled grammar | 0 to walk the combinators
+  comb_frame_t *frames;   // combinators being parsed, innermost last
+  ulong        frame_len, frame_cap;
+  node_t       **values;  // children collected by the frames
+  ulong        value_len, value_cap;
 } parser_t;
 
-parser_t *parser_new(input_t *input, comb_t *base, stack_t *comb_stack) {
+parser_t *parser_new(lexer_t *lexer, comb_t *base, stack_t *comb_stack) {
   parser_t *res = alloc(sizeof(parser_t));
-  res->input      = input;
+  res->lexer      = lexer;
   res->base       = base;
   res->comb_stack = comb_stack;
+  res->memo       = 0;
+  res->vm         = 0;
+  res->frames     = 0;
+  res->frame_len  = 0;
+  res->frame_cap  = 0;
+  res->values     = 0;
+  res->value_len  = 0;
+  res->value_cap  = 0;
   return res;
 }
 
 void parser_free(parser_t *this) {
   if(!this) return;
-  input_free(this->input);
+  memo_free(this->memo);
+  arena_reset(&node_arena, 0);
+  vm_free(this->vm);
+  dealloc(this->frames);
+  dealloc(this->values);
+  lexer_free(this->lexer);
   comb_free(this->base);
   stack_free(&this->comb_stack, (free_f)comb_free);
-  free(this);
+  dealloc(this);
 }
 
-#define input_move() ((cc = input_next(input)) ? (rc++, cc) : cc) //(rc++, input_next(input))
+// combinators run on an explicit stack of frames instead of the c
+// stack, so the nesting depth of the input is only limited by memory
+//
+// comb_enter starts a combinator: JUST combinators and packrat hits
+// deliver their result at once, everything else pushes a frame.
+// the main loop then either lets the top frame start its next child
+// or hands it the result of the child that just finished
 
-#define input_fail() {     \
-  input_rewind(input, rc); \
-  return (node_t*)0;       \
-}
+// -- PROFILE ---------------------------
 
-// -- ID_PARSER -------------------------
+// compiled in with -DPROFILE_PARSER | counts every combinator run by
+// comb_parse. time spent in a child is also added to its parent frame
+// so the exclusive time is what is left
 
-node_t *parse_id(void *env, input_t *input, ulong *rcr) {
-  ulong rc = 0;
-  char cc = 0;
-  char buffer[MAX_STR_LEN] = { 0 };
-  
-  rc += input_skip(input);
+#ifdef PROFILE_PARSER
 
-  if(!is_alpha(buffer[0] = input_move())) input_fail();
-  size_t i = 1;
-  for(;is_alpha_num(buffer[i] = input_move()); i++) {
-    if(i >= MAX_STR_LEN) panic("identifier string too long");
-  }
-  input_rewind(input, 1);
-  rc--;
-  buffer[i] = 0;
+double prof_now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
 
-  *rcr += rc;
-  return node_new(ID_NODE, str_new(buffer), (free_f)str_free);
+void prof_count(parser_t *parser, comb_t *this, node_t *res, double time, double child) {
+  this->prof.calls++;
+  if(res) this->prof.hits++;
+  else    this->prof.fails++;
+  this->prof.incl += time;
+  this->prof.excl += time - child;
+  if(parser->frame_len) parser->frames[parser->frame_len - 1].child += time;
 }
 
-// -- INTEGER_PARSER --------------------
+void prof_fail(parser_t *parser, comb_frame_t *f) {
+  lexer_t *lexer = parser->lexer;
+  f->comb->prof.rewound += lexer_offset(lexer, lexer_tell(lexer)) - lexer_offset(lexer, f->pos);
+  // everything built since the frame started | the nodes of nested
+  // rules included. with packrat they are kept for the table
+  if(!parser->memo) f->comb->prof.dropped += (arena_mark(&node_arena) - f->mark) / sizeof(node_t);
+}
 
-node_t *parse_int(void *env, input_t *input, ulong *rcr) {
-  ulong rc = 0;
-  char cc = 0;
-  char buffer[MAX_STR_LEN] = { 0 };
-  
-  rc += input_skip(input);
+#endif
+
+// a frame failed | drops its children and gives back its tokens
+void comb_fail(parser_t *parser, comb_frame_t *f) {
+#ifdef PROFILE_PARSER
+  prof_fail(parser, f);
+#endif
+  parser->value_len = f->values;
+  if(!parser->memo) node_rewind(f->mark);
+  lexer_seek(parser->lexer, f->pos);
+}
 
-  size_t i = 0;
-  if(!is_num(input_peek(input))) input_fail();
-  for(;is_num(buffer[i] = input_move()); i++) {
-    if(i >= MAX_STR_LEN) panic("integer string too long");
+// 1 if the result is available in res | 0 if a frame was pushed
+int comb_enter(parser_t *parser, comb_t *this, node_t **res) {
+  lexer_t *lexer = parser->lexer;
+  if(this->type == COMB_JUST) {
+#ifdef PROFILE_PARSER
+    double start = prof_now();
+    *res = this->parse(this->env, lexer);
+    prof_count(parser, this, *res, prof_now() - start, 0);
+#else
+    *res = this->parse(this->env, lexer);
+#endif
+    return 1;
   }
-  if(strchr(".f", buffer[i])) input_fail();
-  input_rewind(input, 1);
+  ulong pos = lexer_tell(lexer);
+  if(parser->memo && this->type != COMB_EXPECT) {
+    memo_entry_t *entry = memo_get(parser->memo, this, pos);
+    if(entry) {
+      lexer_seek(lexer, entry->end);
+      *res = entry->res;
+#ifdef PROFILE_PARSER
+      prof_count(parser, this, *res, 0, 0);
+#endif
+      return 1;
+    }
+  }
+  parser->frames = grow(parser->frames, &parser->frame_cap, parser->frame_len, sizeof(comb_frame_t));
+  parser->frames[parser->frame_len++] = (comb_frame_t){ this, pos, this->stack, parser->value_len, arena_mark(&node_arena), 0 };
+#ifdef PROFILE_PARSER
+  parser->frames[parser->frame_len - 1].start = prof_now();
+#endif
+  return 0;
+}
 
-  *rcr += rc;
-  return node_new(INT_NODE, int_new(strtol(buffer, 0, 10)), (free_f)int_free);
+// hands a child to the top frame
+void comb_push(parser_t *parser, node_t *node) {
+  parser->values = grow(parser->values, &parser->value_cap, parser->value_len, sizeof(node_t*));
+  parser->values[parser->value_len++] = node;
 }
 
-// -- FLOAT_PARSER ----------------------
+// closes the children of the top frame into a node of type
+node_t *comb_build(parser_t *parser, comb_frame_t *f, node_type type) {
+  node_t *res = node_build(type, parser->values + f->values, parser->value_len - f->values);
+  parser->value_len = f->values;
+  return res;
+}
 
-node_t *parse_float(void *env, input_t *input, ulong *rcr) {
-  ulong rc = 0;
-  char cc = 0;
-  char buffer[MAX_STR_LEN] = { 0 };
-  size_t i = 0;
+// pops the top frame with its result
+node_t *comb_leave(parser_t *parser, node_t *res) {
+  comb_frame_t *f = &parser->frames[--parser->frame_len];
+#ifdef PROFILE_PARSER
+  prof_count(parser, f->comb, res, prof_now() - f->start, f->child);
+#endif
+  if(parser->memo && f->comb->type != COMB_EXPECT) {
+    memo_put(parser->memo, f->comb, f->pos, lexer_tell(parser->lexer), res);
+  }
+  return res;
+}
 
-  rc += input_skip(input);
+// the next child the top frame has to run | 0 if it is done
+// a frame that is done without a child leaves its result in res
+comb_t *comb_step(parser_t *parser, comb_frame_t *f, node_t **res) {
+  comb_t *this = f->comb;
+  switch(this->type) {
+    case COMB_OR: {
+      uint64_t class = lexer_class(parser->lexer);
+      for(comb_t *elem = 0; (elem = stack_next(&f->iter));) {
+        // alternatives that can not start with the next token are skipped
+        if((elem->first & class) || elem->nullable) return elem;
+      }
+      *res = 0;
+      return 0;
+    }
+    case COMB_AND:
+      // iter moves on once the element matched
+      if(f->iter) return f->iter->obj;
+      *res = comb_build(parser, f, this->n_type);
+      return 0;
+    case COMB_OPT:
+      return f->state ? this->sep : this->elem;
+    case COMB_EXPECT:
+      return this->exp;
+    case COMB_FACTOR: {
+      if(!f->state) return this->prefix;
+      uint64_t class = lexer_class(parser->lexer);
+      for(comb_t *tail = 0; (tail = stack_next(&f->iter));) {
+        if((tail->first & class) || tail->nullable) return tail;
+      }
+      comb_fail(parser, f);
+      *res = 0;
+      return 0;
+    }
+    default:
+      panic("undefined parser combinator");
+  }
+}
 
-  if(!is_num(input_peek(input))) input_fail();
-  for(; is_num(buffer[i] = input_move()); i++) {
-    if(i >= MAX_STR_LEN) panic("float string too long");
+// hands the result of a child to the top frame
+// returns 1 if the frame is done with its result in res
+int comb_resume(parser_t *parser, comb_frame_t *f, node_t **res) {
+  comb_t *this = f->comb;
+  lexer_t *lexer = parser->lexer;
+  switch(this->type) {
+    case COMB_OR:
+      if(*res) return 1;
+      comb_fail(parser, f);
+      return 0;
+    case COMB_AND:
+      if(!*res) {
+        comb_fail(parser, f);
+        return 1;
+      }
+      if(!((comb_t*)f->iter->obj)->drop) comb_push(parser, *res);
+      f->iter = f->iter->next;
+      return 0;
+    case COMB_OPT:
+      if(!f->state) {
+        if(*res) {
+          comb_push(parser, *res);
+          f->state = this->sep != 0;
+          return 0;
+        }
+      } else if(*res) {
+        f->state = 0;
+        return 0;
+      } else if(this->sl) {
+        comb_fail(parser, f);
+        return 1;
+      }
+      *res = comb_build(parser, f, this->n_type);
+      return 1;
+    case COMB_EXPECT:
+      if(!*res) comb_error(this, lexer);
+      return 1;
+    case COMB_FACTOR:
+      if(!f->state) {
+        if(!*res) return 1;
+        // the prefix is parsed once and shared by every tail
+        if(!this->prefix->drop) comb_push(parser, *res);
+        f->iter = this->tails;
+        f->state = 1;
+        return 0;
+      }
+      if(!*res) return 0;
+      if(!this->prefix->drop) *res = node_prepend(*res, parser->values[f->values]);
+      parser->value_len = f->values;
+      return 1;
+    default:
+      panic("undefined parser combinator");
   }
-  if(buffer[i] == 'f') {
-    *rcr += rc;
-    return node_new(FLOAT_NODE, float_new(strtod(buffer, 0)), (free_f)float_free);
-  } else if(buffer[i] == '.') {
-    for(i++; is_num(buffer[i] = input_move()); i++) {
-      if(i >= MAX_STR_LEN) panic("float string too long");
+}
+
+// runs a combinator | consults the packrat table if there is one
+node_t *comb_parse(parser_t *parser, comb_t *this) {
+  if(!this) return 0;
+  node_t *res = 0;
+  ulong base = parser->frame_len;
+  int done = comb_enter(parser, this, &res);
+  while(parser->frame_len > base) {
+    comb_frame_t *f = &parser->frames[parser->frame_len - 1];
+    if(done) {
+      done = comb_resume(parser, f, &res);
+    } else {
+      comb_t *child = comb_step(parser, f, &res);
+      done = child ? comb_enter(parser, child, &res) : 1;
+      if(child) continue;
+    }
+    if(parser->lexer->failed) {
+      // a failed expect drops the whole item
+      comb_frame_t *f = &parser->frames[base];
+      parser->value_len = f->values;
+      if(!parser->memo) node_rewind(f->mark);
+      lexer_seek(parser->lexer, f->pos);
+      parser->frame_len = base;
+      return 0;
     }
-    input_rewind(input, 1);
-    *rcr += rc;
-    return node_new(FLOAT_NODE, float_new(strtod(buffer, 0)), (free_f)float_free);
+    if(done) res = comb_leave(parser, res);
   }
-  input_fail();
+  return res;
 }
 
-// -- CHAR_PARSER -----------------------
+// every primitive matches exactly one token
+// a failing primitive does not move the lexer
 
-node_t *parse_char(void *env, input_t *input, ulong *rcr) {
-  ulong rc = 0;
-  char cc = 0;
+// -- ID_PARSER -------------------------
 
-  rc += input_skip(input);
-  
-  char c = 0;
-  if(input_move() != '\'') input_fail();
-  if((c = input_move()) == '\\') {
-    switch((c = input_move())) {
-      case 'n': c = '\n'; break;
-      case 't': c = '\t'; break;
-      case 'r': c = '\r'; break;
-      case '\'': c = '\''; break;
-      case '\\': c = '\\'; break;
-      default: panic("invalid escape char %c", c);
-    }
-  }
-  if(!c) panic("end of file not expected");
-  
-  if(input_move() != '\'') panic("\"'\" expected");
+// the name is interned once per token | backtracking over the token
+// does not even hash it again
+node_t *parse_id(void *env, lexer_t *lexer) {
+  token_t *tok = lexer_peek(lexer);
+  if(tok->kind != TOK_ID) return 0;
+  lexer_next(lexer);
+  if(!tok->id) tok->id = intern(lexer_slice(lexer, tok->offset, tok->len, 0), tok->len);
+  node_t *res = node_new(ID_NODE);
+  res->pos = tok->offset;
+  res->str = tok->id;
+  return res;
+}
+
+// -- INTEGER_PARSER --------------------
 
-  *rcr += rc;
-  return node_new(CHAR_NODE, char_new(c), (free_f)char_free);
+node_t *parse_int(void *env, lexer_t *lexer) {
+  token_t *tok = lexer_peek(lexer);
+  if(tok->kind != TOK_INT) return 0;
+  lexer_next(lexer);
+  node_t *res = node_new(INT_NODE);
+  res->pos  = tok->offset;
+  res->ival = tok->ival;
+  return res;
 }
 
-// -- STRING_PARSER ---------------------
+// -- FLOAT_PARSER ----------------------
 
-node_t *parse_str(void *env, input_t *input, ulong *rcr) {
-  ulong rc = 0;
-  char cc = 0;
-  char buffer[MAX_STR_LEN] = { 0 };
-  
-  rc += input_skip(input);
-
-  if(input_move() != '"') input_fail();
-  size_t i = 0;
-  for(; (buffer[i] = input_move()); i++) {
-    if(buffer[i] == '"') {
-      if(i && buffer[i-1] == '\\') continue;
-      else break;
-    }
-    if(!is_str(buffer[i])) panic("invalid char inside string: %c", buffer[i]);
-  }
-  buffer[i] = 0;
+node_t *parse_float(void *env, lexer_t *lexer) {
+  token_t *tok = lexer_peek(lexer);
+  if(tok->kind != TOK_FLOAT) return 0;
+  lexer_next(lexer);
+  node_t *res = node_new(FLOAT_NODE);
+  res->pos  = tok->offset;
+  res->fval = tok->fval;
+  return res;
+}
+
+// -- CHAR_PARSER -----------------------
 
-  *rcr += rc;
-  return node_new(STR_NODE, str_new(buffer), (free_f)str_free);
+node_t *parse_char(void *env, lexer_t *lexer) {
+  token_t *tok = lexer_peek(lexer);
+  if(tok->kind != TOK_CHAR) return 0;
+  lexer_next(lexer);
+  node_t *res = node_new(CHAR_NODE);
+  res->pos  = tok->offset;
+  res->cval = tok->cval;
+  return res;
+}
+
+// -- STRING_PARSER ---------------------
+
+node_t *parse_str(void *env, lexer_t *lexer) {
+  token_t *tok = lexer_peek(lexer);
+  if(tok->kind != TOK_STR) return 0;
+  lexer_next(lexer);
+  // strip the quotes | an unterminated string runs until the end of file
+  ulong len = tok->len - 1;
+  if(len && input_at(lexer->input, tok->offset + len) == '"') len--;
+  node_t *res = node_new(STR_NODE);
+  res->pos = tok->offset;
+  res->str = str_new(lexer_slice(lexer, tok->offset + 1, len, 0), len);
+  return res;
 }
 
 // --  ----------------------------------
@@ -720,51 +2283,323 @@ typedef struct closure_env_t {
   char *ref;
   node_type type;
   int is_op;
+  int sym;   // symbol of the operator | keyword in the lexer
 } closure_env_t;
 
 void closure_env_free(closure_env_t *this) {
   if(!this) return;
-  free(this);
+  dealloc(this);
 }
 
 // -- CUSTOM_PARSER ---------------------
 
-node_t *parse_op(closure_env_t *env, input_t *input, ulong *rcr) {
-  ulong rc = 0;
-  char cc = 0;
+node_t *parse_op(closure_env_t *env, lexer_t *lexer) {
+  token_t *tok = lexer_peek(lexer);
+  if(tok->kind != (env->is_op ? TOK_OP : TOK_ID) || tok->sym != env->sym) return 0;
+  lexer_next(lexer);
+  return node_new(env->type);
+}
 
-  rc += input_skip(input);
+// -- EOF_PARSER ------------------------
 
-  for(size_t i = 0; env->ref[i]; i++) {
-    if(input_move() != env->ref[i]) input_fail();
+node_t *parse_eof(void *env, lexer_t *lexer) {
+  if(lexer_peek(lexer)->kind != TOK_EOF) return 0;
+  return node_new(EOF_NODE);
+}
+
+// -- RECOVERY_PARSER -------------------
+
+// 1 if tok is the single char c
+int lexer_is_char(lexer_t *lexer, token_t *tok, char c) {
+  return tok->kind >= TOK_OP && tok->len == 1 && input_at(lexer->input, tok->offset) == c;
+}
+
+// the furthest token any alternative looked at | where the input
+// stopped making sense
+token_t *lexer_far(lexer_t *lexer) {
+  return &lexer->toks[lexer->len - 1 - lexer->base];
+}
+
+// a statement that none of the others matches | it is reported and
+// skipped up to its ; so the rest of the body is still checked
+node_t *parse_skip(closure_env_t *env, lexer_t *lexer) {
+  token_t *tok = lexer_peek(lexer);
+  if(tok->kind == TOK_EOF || lexer_is_char(lexer, tok, '}')) return 0;
+  if(lexer_far(lexer)->kind != TOK_ERR) parse_report(lexer, lexer_far(lexer)->offset, "unexpected token in ", "statement");
+  for(; tok->kind != TOK_EOF && !lexer_is_char(lexer, tok, '}'); tok = lexer_peek(lexer)) {
+    lexer_next(lexer);
+    if(lexer_is_char(lexer, tok, ';')) break;
   }
-  if(!env->is_op && is_alpha_num(input_peek(input))) input_fail();
+  return node_new(env->type);
+}
 
-  *rcr += rc;
-  return node_new(env->type, 0, (free_f)nop_free);
+// gives an operator | keyword combinator its symbol in the lexer
+void parser_register_op(comb_t *this, lexer_t *lexer) {
+  if(this->type != COMB_JUST || this->parse != (parse_f)parse_op) return;
+  closure_env_t *env = this->env;
+  if(!env->is_op) {
+    env->sym = lexer_add_key(lexer, env->ref);
+    return;
+  }
+  env->sym = lexer_add_op(lexer, env->ref);
+  this->first = CLASS_OP(env->sym);
 }
 
-// -- EOF_PARSER ------------------------
+// -- LOOKAHEAD -------------------------
 
-node_t *parse_eof(void *env, input_t *input, ulong *rcr) {
-  ulong rc = 0;
-  char cc = 0;
-  
-  rc += input_skip(input);
-  
-  if(input_move() != 0) input_fail();
-  
-  *rcr += rc;
-  return node_new(EOF_NODE, 0, (free_f)nop_free);
+// computes the first set of a combinator from its children
+// JUST combinators get theirs when they are created
+void comb_first_update(comb_t *this, int *changed) {
+  uint64_t first = 0;
+  int nullable = 0;
+  switch(this->type) {
+    case COMB_NONE:
+      first = CLASS_ALL;
+      nullable = 1;
+      break;
+    case COMB_JUST:
+      return;
+    case COMB_OR:
+      for(stack_t *s = this->stack; s; s = s->next) {
+        first |= ((comb_t*)s->obj)->first;
+        nullable |= ((comb_t*)s->obj)->nullable;
+      }
+      break;
+    case COMB_AND:
+      nullable = 1;
+      for(stack_t *s = this->stack; s && nullable; s = s->next) {
+        first |= ((comb_t*)s->obj)->first;
+        nullable = ((comb_t*)s->obj)->nullable;
+      }
+      break;
+    case COMB_OPT:
+      first = this->elem->first;
+      nullable = 1;
+      break;
+    case COMB_EXPECT:
+      // either matches or stops with an error | never skipped
+      first = CLASS_ALL;
+      nullable = this->exp->nullable;
+      break;
+    case COMB_FACTOR:
+      first = this->prefix->first;
+      if(!this->prefix->nullable) break;
+      for(stack_t *s = this->tails; s; s = s->next) {
+        first |= ((comb_t*)s->obj)->first;
+        nullable |= ((comb_t*)s->obj)->nullable;
+      }
+      break;
+  }
+  if(first != this->first || nullable != this->nullable) {
+    this->first = first;
+    this->nullable = nullable;
+    *changed = 1;
+  }
+}
+
+// first sets of the whole graph | iterated until nothing changes
+void comb_analyze(comb_t *this) {
+  for(int changed = 1; changed;) {
+    changed = 0;
+    comb_walk(this, (comb_walk_f)comb_first_update, &changed);
+  }
+}
+
+// -- LEFT_FACTORING --------------------
+
+// 1 if a and b match the same tokens into the same node
+int comb_same(comb_t *a, comb_t *b) {
+  if(a == b) return 1;
+  if(a->drop != b->drop) return 0;
+  if(a->type != COMB_JUST || b->type != COMB_JUST || a->parse != b->parse) return 0;
+  if(a->env == b->env) return 1;
+  if(a->parse != (parse_f)parse_op) return 0;
+  closure_env_t *x = a->env, *y = b->env;
+  return x->is_op == y->is_op && x->type == y->type && !strcmp(x->ref, y->ref);
+}
+
+// 1 if the alternatives a and b are ANDs starting with the same combinator
+int comb_same_prefix(comb_t *a, comb_t *b) {
+  if(a->type != COMB_AND || b->type != COMB_AND) return 0;
+  if(!a->stack || !b->stack) return 0;
+  return comb_same(a->stack->obj, b->stack->obj);
+}
+
+// alternatives [from, to) of an OR as one FACTOR combinator
+comb_t *comb_factor_run(stack_t *from, stack_t *to) {
+  comb_t *res = comb_new();
+  res->type   = COMB_FACTOR;
+  res->prefix = comb_share(((comb_t*)from->obj)->stack->obj);
+  for(stack_t *s = from; s != to; s = s->next) {
+    comb_t *alt  = s->obj;
+    comb_t *tail = comb_new();
+    tail->type   = COMB_AND;
+    tail->n_type = alt->n_type;
+    tail->name   = alt->name;
+    for(stack_t *e = alt->stack->next; e; e = e->next) {
+      stack_push(&tail->stack, comb_share(e->obj));
+    }
+    stack_inverse(&tail->stack);
+    stack_push(&res->tails, tail);
+  }
+  stack_inverse(&res->tails);
+  return res;
+}
+
+// rewrites adjacent alternatives of an OR that start with the same
+// combinator | "a b / a c" becomes "a (b / c)" which is the same
+// ordered choice since a matches the same way both times. only
+// neighbours are grouped, moving alternatives could change the result
+void comb_factor(comb_t *this, void *ctx) {
+  if(this->type != COMB_OR) return;
+  stack_t *res = 0;
+  for(stack_t *s = this->stack, *end = 0; s; s = end) {
+    for(end = s->next; end && comb_same_prefix(s->obj, end->obj); end = end->next);
+    if(end == s->next) {
+      stack_push(&res, s->obj);
+      continue;
+    }
+    stack_push(&res, comb_factor_run(s, end));
+    for(stack_t *e = s; e != end; e = e->next) comb_free(e->obj);
+  }
+  stack_inverse(&res);
+  for(stack_t *s = this->stack; s; s = this->stack) {
+    this->stack = s->next;
+    dealloc(s);
+    mem_gone(MEM_STACK, sizeof(stack_t));
+  }
+  this->stack = res;
 }
 
 // -- MAIN_PARSER  ----------------------
 
+#ifdef GEN_PARSER
+// written by comp --gen-parser | see make gen-parser
+#include "parser_gen.c"
+#endif
+
 node_t *parse(parser_t *parser) {
-  ulong rc = 0;
-  return comb_parse(parser->input, parser->base, &rc);
+#ifdef GEN_PARSER
+  return gen_parse(parser->lexer);
+#else
+  if(parser->vm) return vm_run(parser->vm, parser->lexer);
+  return comb_parse(parser, parser->base);
+#endif
+}
+
+// skips a top-level item that did not parse | up to the next ; or }
+// outside of braces. the run goes on and reports every error
+void parser_recover(parser_t *parser) {
+  lexer_t *lexer = parser->lexer;
+  if(!lexer->failed && lexer_far(lexer)->kind != TOK_ERR) parse_report(lexer, lexer_far(lexer)->offset, "unexpected token in ", "top-level item");
+  lexer->failed = 0;
+  int depth = 0;
+  for(token_t *tok = lexer_peek(lexer); tok->kind != TOK_EOF; tok = lexer_peek(lexer)) {
+    lexer_next(lexer);
+    if(lexer_is_char(lexer, tok, '{')) {
+      depth++;
+    } else if(lexer_is_char(lexer, tok, '}')) {
+      if(--depth <= 0) break;
+    } else if(lexer_is_char(lexer, tok, ';') && depth <= 0) {
+      break;
+    }
+  }
+  if(parser->memo) memo_clear(parser->memo);
+  node_held();
+  arena_reset(&node_arena, 0);
+  lexer_commit(lexer);
+}
+
+// the last parsed item is done | its tokens, input, cached results and
+// nodes can be released
+void parser_commit(parser_t *parser) {
+  if(parser->memo) memo_clear(parser->memo);
+  node_held();
+  arena_reset(&node_arena, 0);
+  lexer_commit(parser->lexer);
+}
+
+// -- PROFILE_REPORT --------------------
+
+#ifdef PROFILE_PARSER
+
+// rule name of a combinator | describes the anonymous ones
+char *prof_label(comb_t *this, char *buffer, int size) {
+  closure_env_t *env = this->env;
+  if(this->name) {
+    int len = strlen(this->name);
+    if(len > 5 && !strcmp(this->name + len - 5, "_comb")) len -= 5;
+    if(len >= size) len = size - 1;
+    for(int i = 0; i < len; i++) buffer[i] = this->name[i] >= 'a' && this->name[i] <= 'z' ? this->name[i] - 32 : this->name[i];
+    buffer[len] = 0;
+    return buffer;
+  }
+  switch(this->type) {
+    case COMB_JUST:
+      if(this->parse == (parse_f)parse_op)   snprintf(buffer, size, "'%s'", env->ref);
+      else if(this->parse == parse_id)       snprintf(buffer, size, "ID");
+      else if(this->parse == parse_int)      snprintf(buffer, size, "INT");
+      else if(this->parse == parse_float)    snprintf(buffer, size, "FLOAT");
+      else if(this->parse == parse_char)     snprintf(buffer, size, "CHAR");
+      else if(this->parse == parse_str)      snprintf(buffer, size, "STR");
+      else if(this->parse == parse_eof)      snprintf(buffer, size, "EOF");
+      else if(this->parse == (parse_f)parse_skip) snprintf(buffer, size, "skip");
+      else                                   snprintf(buffer, size, "custom");
+      break;
+    case COMB_EXPECT:
+      snprintf(buffer, size, "expect %s", this->desc);
+      break;
+    case COMB_FACTOR: {
+      // the alternatives it joins
+      int len = 0;
+      for(stack_t *t = this->tails; t && len < size - 1; t = t->next) {
+        if(len) buffer[len++] = '/';
+        prof_label(t->obj, buffer + len, size - len);
+        len += strlen(buffer + len);
+      }
+      buffer[len] = 0;
+      break;
+    }
+    default:
+      snprintf(buffer, size, "anonymous %d", this->n_type);
+      break;
+  }
+  return buffer;
+}
+
+void prof_collect(comb_t *this, stack_t **res) {
+  stack_push(res, this);
+}
+
+int prof_cmp(const void *a, const void *b) {
+  double x = (*(comb_t**)a)->prof.excl, y = (*(comb_t**)b)->prof.excl;
+  return x < y ? 1 : x > y ? -1 : 0;
+}
+
+// every combinator that ran | sorted by exclusive time
+void prof_report(parser_t *parser) {
+  stack_t *stack = 0;
+  comb_walk(parser->base, (comb_walk_f)prof_collect, &stack);
+  ulong len = 0;
+  for(stack_t *s = stack; s; s = s->next) len++;
+  comb_t **combs = alloc(len * sizeof(comb_t*));
+  for(ulong i = 0; i < len; i++) combs[i] = stack_pop(&stack);
+  qsort(combs, len, sizeof(comb_t*), prof_cmp);
+  char label[64];
+  fprintf(stderr, "%-24s %10s %10s %10s %12s %10s %10s %10s\n",
+          "rule", "calls", "hits", "fails", "rewound", "dropped", "incl ms", "excl ms");
+  for(ulong i = 0; i < len; i++) {
+    prof_t *p = &combs[i]->prof;
+    if(!p->calls) continue;
+    fprintf(stderr, "%-24s %10lu %10lu %10lu %12lu %10lu %10.2f %10.2f\n",
+            prof_label(combs[i], label, sizeof(label)), p->calls, p->hits, p->fails,
+            p->rewound, p->dropped, p->incl * 1000, p->excl * 1000);
+  }
+  dealloc(combs);
 }
 
+#endif
+
 //---------------------------------------
 // COMBINATOR_FUNCTIONS 
 //---------------------------------------
@@ -775,6 +2610,7 @@ comb_t *match_id() {
   comb_t *res = comb_new(); 
   res->type = COMB_JUST;
   res->parse = parse_id;
+  res->first = CLASS_KIND(TOK_ID);
   return res;
 }
 
@@ -782,6 +2618,7 @@ comb_t *match_int() {
   comb_t *res = comb_new();
   res->type =COMB_JUST;
   res->parse = parse_int;
+  res->first = CLASS_KIND(TOK_INT);
   return res;
 }
 
@@ -789,6 +2626,7 @@ comb_t *match_float() {
   comb_t *res = comb_new();
   res->type = COMB_JUST;
   res->parse = parse_float;
+  res->first = CLASS_KIND(TOK_FLOAT);
   return res;
 }
 
@@ -796,6 +2634,7 @@ comb_t *match_char() {
   comb_t *res = comb_new();
   res->type = COMB_JUST;
   res->parse = parse_char;
+  res->first = CLASS_KIND(TOK_CHAR);
   return res;
 }
  
@@ -803,6 +2642,7 @@ comb_t *match_str() {
   comb_t *res = comb_new();
   res->type = COMB_JUST;
   res->parse = parse_str;
+  res->first = CLASS_KIND(TOK_STR);
   return res;
 }
 
@@ -813,9 +2653,12 @@ comb_t *match_custom(char *str, node_type type, int is_op) {
   env->ref = str;
   env->type = type;
   env->is_op = is_op;
+  env->sym = -1;
   res->env = env;
   res->env_free = (void (*)(void*))closure_env_free;
   res->parse = (parse_f)parse_op;
+  // operators get their class once they are registered in the lexer
+  res->first = is_op ? 0 : CLASS_KIND(TOK_ID);
   return res;
 }
 
@@ -827,10 +2670,27 @@ comb_t *match_key(char *key, node_type type) {
   return match_custom(key, type, 0);
 }
 
+comb_t *match_skip(node_type type) {
+  comb_t *res = comb_new();
+  res->type = COMB_JUST;
+  closure_env_t *env = alloc(sizeof(closure_env_t));
+  env->ref = 0;
+  env->type = type;
+  env->is_op = 0;
+  env->sym = -1;
+  res->env = env;
+  res->env_free = (void (*)(void*))closure_env_free;
+  res->parse = (parse_f)parse_skip;
+  // anything but the end of a body
+  res->first = CLASS_ALL;
+  return res;
+}
+
 comb_t *match_eof() {
   comb_t *res = comb_new();
   res->type = COMB_JUST;
   res->parse = parse_eof;
+  res->first = CLASS_KIND(TOK_EOF);
   return res;
 }
 
@@ -861,6 +2721,11 @@ comb_t *comb_add(comb_t *this, stack_t *stack) {
   return this;
 }
 
+comb_t *comb_name(comb_t *this, char *name) {
+  this->name = name;
+  return this;
+}
+
 comb_t *match_opt(comb_t *this, node_type type, comb_t *elem, comb_t *sep, int sl) {
   if(this->type != COMB_NONE) error("combinator already defined");
   this->type   = COMB_OPT;
@@ -876,23 +2741,371 @@ comb_t *expect(comb_t *this, char *desc) {
   res->type = COMB_EXPECT;
   res->exp  = this;
   res->desc = desc;
+  res->drop = this->drop;
   return res;
 }
 
+// punctuation and keywords | the element has to match but the node of
+// the sequence does not keep it. the flag belongs to the combinator and
+// expect passes it on. where the combinator stands on its own (the
+// empty statement) its node is kept
+comb_t *drop(comb_t *this) {
+  this->drop = 1;
+  return this;
+}
+
+//---------------------------------------
+// PARSER_GENERATOR
+//---------------------------------------
+
+// writes the combinator graph as c | every combinator except JUST
+// becomes a static function, tokens are matched inline and the
+// alternatives of OR and FACTOR become a switch over the class of the
+// next token. the output is included by a build with -DGEN_PARSER
+// which then runs without a graph
+
+typedef struct gen_t {
+  output_t *out;
+  lexer_t  *lexer;
+  comb_t   **combs;
+  ulong    len, cap;
+} gen_t;
+
+void gen_collect(comb_t *this, gen_t *gen) {
+  gen->combs = grow(gen->combs, &gen->cap, gen->len, sizeof(comb_t*));
+  gen->combs[gen->len++] = this;
+}
+
+int gen_index(gen_t *this, comb_t *comb) {
+  for(ulong i = 0; i < this->len; i++) {
+    if(this->combs[i] == comb) return i;
+  }
+  panic("combinator not collected");
+}
+
+// c string literal of str
+void gen_str(gen_t *this, char *str) {
+  emit(this->out, "\"");
+  for(; *str; str++) {
+    if(*str == '"' || *str == '\\') emitf(this->out, "\\%c", *str);
+    else                            emitf(this->out, "%c", *str);
+  }
+  emit(this->out, "\"");
+}
+
+// function name of a rule | the _comb suffix is dropped
+void gen_name(gen_t *this, comb_t *comb) {
+  if(!comb->name) {
+    emitf(this->out, "gen_%d", gen_index(this, comb));
+    return;
+  }
+  int len = strlen(comb->name);
+  if(len > 5 && !strcmp(comb->name + len - 5, "_comb")) len -= 5;
+  emitf(this->out, "gen_%.*s", len, comb->name);
+  // factor tails keep the name of their alternative
+  int index = gen_index(this, comb);
+  for(int i = 0; i < index; i++) {
+    if(this->combs[i]->name && !strcmp(this->combs[i]->name, comb->name)) {
+      emitf(this->out, "_%d", index);
+      break;
+    }
+  }
+}
+
+// expression matching comb | a node or 0
+void gen_ref(gen_t *this, comb_t *comb) {
+  output_t *out = this->out;
+  if(comb->type != COMB_JUST) {
+    gen_name(this, comb);
+    emit(out, "(lexer)");
+    return;
+  }
+  if(comb->parse == (parse_f)parse_op) {
+    closure_env_t *env = comb->env;
+    emitf(out, "gen_match(lexer, %s, %d, %d)", env->is_op ? "TOK_OP" : "TOK_ID", env->sym, env->type);
+    return;
+  }
+  if(comb->parse == (parse_f)parse_skip) {
+    emitf(out, "parse_skip(&(closure_env_t){ 0, %d, 0, -1 }, lexer)", ((closure_env_t*)comb->env)->type);
+    return;
+  }
+  struct { parse_f parse; char *name; } prims[] = {
+    { parse_id, "parse_id" }, { parse_int, "parse_int" }, { parse_float, "parse_float" },
+    { parse_char, "parse_char" }, { parse_str, "parse_str" }, { parse_eof, "parse_eof" }
+  };
+  for(int i = 0; i < sizeof(prims) / sizeof(prims[0]); i++) {
+    if(comb->parse != prims[i].parse) continue;
+    emitf(out, "%s(0, lexer)", prims[i].name);
+    return;
+  }
+  panic("unable to generate a custom combinator");
+}
+
+// token class of bit as a case label
+void gen_case(gen_t *this, int bit) {
+  char *kinds[] = { "TOK_EOF", "TOK_ID", "TOK_INT", "TOK_FLOAT", "TOK_CHAR", "TOK_STR", "TOK_OP", "TOK_ERR" };
+  if(bit <= TOK_ERR) {
+    emitf(this->out, "    case %s:\n", kinds[bit]);
+    return;
+  }
+  emitf(this->out, "    case TOK_ERR + 1 + %d: // ", bit - TOK_ERR - 1);
+  for(ulong i = 0; i < this->len; i++) {
+    comb_t *comb = this->combs[i];
+    if(comb->type != COMB_JUST || comb->parse != (parse_f)parse_op) continue;
+    closure_env_t *env = comb->env;
+    if(!env->is_op || env->sym != bit - TOK_ERR - 1) continue;
+    emitf(this->out, "%s", env->ref);
+    break;
+  }
+  emit(this->out, "\n");
+}
+
+// the alternatives of alts able to start with class bit | one bit each
+uint64_t gen_alts_of(stack_t *alts, int bit) {
+  uint64_t res = 0;
+  int i = 0;
+  for(stack_t *s = alts; s; s = s->next, i++) {
+    comb_t *alt = s->obj;
+    if(alt->nullable || (bit >= 0 && (alt->first & (1ull << bit)))) res |= 1ull << i;
+  }
+  return res;
+}
+
+// switch over the next token | tries the alternatives in order with
+// the same skips as the lookahead of the interpreter
+// on success the alternative is returned through ret ("%s" is the node)
+void gen_switch(gen_t *this, stack_t *alts, char *ret, char *fail) {
+  output_t *out = this->out;
+  uint64_t all = 0;
+  int count = 0;
+  for(stack_t *s = alts; s; s = s->next, count++) all |= ((comb_t*)s->obj)->first;
+  if(count > 64) panic("too many alternatives to generate");
+  uint64_t none = gen_alts_of(alts, -1);
+  uint64_t done = 0;
+  emit_line(out, "  switch(gen_class(lexer)) {");
+  for(int bit = 0; bit <= 64; bit++) {
+    uint64_t mask = 0;
+    if(bit < 64) {
+      if(!(all & (1ull << bit)) || (done & (1ull << bit))) continue;
+      mask = gen_alts_of(alts, bit);
+      if(mask == none) continue;
+      // classes with the same alternatives share the case
+      for(int b = bit; b < 64; b++) {
+        if(!(all & (1ull << b)) || gen_alts_of(alts, b) != mask) continue;
+        gen_case(this, b);
+        done |= 1ull << b;
+      }
+    } else {
+      if(!none) break;
+      mask = none;
+      emit_line(out, "    default:");
+    }
+    int i = 0;
+    for(stack_t *s = alts; s; s = s->next, i++) {
+      if(!(mask & (1ull << i))) continue;
+      emit(out, "      if((res = ");
+      gen_ref(this, s->obj);
+      emit_line(out, ")) {");
+      emitf(out, "        return ");
+      emitf(out, ret, "res");
+      emit_line(out, ";");
+      emit_line(out, "      }");
+      if(*fail) emitf(out, "      %s\n", fail);
+      emit_line(out, "      if(lexer->failed) break;");
+    }
+    emit_line(out, "      break;");
+  }
+  emit_line(out, "  }");
+}
+
+void gen_rule(gen_t *this, comb_t *comb) {
+  output_t *out = this->out;
+  emit(out, "static node_t *");
+  gen_name(this, comb);
+  emit_line(out, "(lexer_t *lexer) {");
+  switch(comb->type) {
+    case COMB_NONE:
+      emit_line(out, "  return 0;");
+      break;
+    case COMB_JUST:
+      emit(out, "  return ");
+      gen_ref(this, comb);
+      emit_line(out, ";");
+      break;
+    case COMB_OR:
+      emit_line(out, "  ulong pos = lexer_tell(lexer);");
+      emit_line(out, "  node_t *res = 0;");
+      gen_switch(this, comb->stack, "%s", "lexer_seek(lexer, pos);");
+      emit_line(out, "  return 0;");
+      break;
+    case COMB_AND: {
+      if(!comb->stack) {
+        emitf(out, "  return node_build(%d, 0, 0);\n", comb->n_type);
+        break;
+      }
+      int len = 0;
+      for(stack_t *s = comb->stack; s; s = s->next) len += !((comb_t*)s->obj)->drop;
+      emit_line(out, "  ulong pos = lexer_tell(lexer);");
+      emit_line(out, "  ulong mark = arena_mark(&node_arena);");
+      if(len) emitf(out, "  node_t *kids[%d];\n", len);
+      len = 0;
+      for(stack_t *s = comb->stack; s; s = s->next) {
+        if(((comb_t*)s->obj)->drop) emit(out, "  if(!(");
+        else                        emitf(out, "  if(!(kids[%d] = ", len++);
+        gen_ref(this, s->obj);
+        emit_line(out, ")) goto fail;");
+      }
+      emitf(out, "  return node_build(%d, %s, %d);\n", comb->n_type, len ? "kids" : "0", len);
+      emit_line(out, "fail:");
+      emit_line(out, "  node_rewind(mark);");
+      emit_line(out, "  lexer_seek(lexer, pos);");
+      emit_line(out, "  return 0;");
+      break;
+    }
+    case COMB_OPT:
+      if(comb->sl) {
+        emit_line(out, "  ulong pos = lexer_tell(lexer);");
+        emit_line(out, "  ulong mark = arena_mark(&node_arena);");
+      }
+      emit_line(out, "  ulong base = gen_value_len;");
+      emit_line(out, "  node_t *node = 0;");
+      emit(out, "  while((node = ");
+      gen_ref(this, comb->elem);
+      emit_line(out, ")) {");
+      emit_line(out, "    gen_push(node);");
+      if(comb->sep) {
+        emit(out, "    if(!(node = ");
+        gen_ref(this, comb->sep);
+        emit_line(out, ")) {");
+        if(comb->sl) {
+          emit_line(out, "      gen_value_len = base;");
+          emit_line(out, "      node_rewind(mark);");
+          emit_line(out, "      lexer_seek(lexer, pos);");
+          emit_line(out, "      return 0;");
+        } else {
+          emit_line(out, "      break;");
+        }
+        emit_line(out, "    }");
+      }
+      emit_line(out, "  }");
+      emit_line(out, "  if(lexer->failed) {");
+      emit_line(out, "    gen_value_len = base;");
+      emit_line(out, "    return 0;");
+      emit_line(out, "  }");
+      emitf(out, "  node = node_build(%d, gen_values + base, gen_value_len - base);\n", comb->n_type);
+      emit_line(out, "  gen_value_len = base;");
+      emit_line(out, "  return node;");
+      break;
+    case COMB_EXPECT:
+      emit(out, "  node_t *node = ");
+      gen_ref(this, comb->exp);
+      emit_line(out, ";");
+      emit(out, "  if(!node && !lexer->failed) parse_error(");
+      gen_str(this, comb->desc);
+      emit_line(out, ", lexer);");
+      emit_line(out, "  return node;");
+      break;
+    case COMB_FACTOR:
+      emit_line(out, "  ulong pos = lexer_tell(lexer);");
+      emit_line(out, "  ulong mark = arena_mark(&node_arena);");
+      emit_line(out, "  node_t *res = 0;");
+      emit(out, "  node_t *prefix = ");
+      gen_ref(this, comb->prefix);
+      emit_line(out, ";");
+      emit_line(out, "  if(!prefix) return 0;");
+      gen_switch(this, comb->tails, comb->prefix->drop ? "%s" : "node_prepend(%s, prefix)", "");
+      emit_line(out, "  node_rewind(mark);");
+      emit_line(out, "  lexer_seek(lexer, pos);");
+      emit_line(out, "  return 0;");
+      break;
+  }
+  emit_line(out, "}");
+  emit_line(out, "");
+}
+
+// registers the operators and keywords in the order of their symbols
+void gen_init(gen_t *this) {
+  output_t *out = this->out;
+  emit_line(out, "void gen_parser_init(lexer_t *lexer) {");
+  for(int is_op = 1; is_op >= 0; is_op--) {
+    int count = is_op ? this->lexer->op_count : this->lexer->key_count;
+    for(int sym = 0; sym < count; sym++) {
+      for(ulong i = 0; i < this->len; i++) {
+        comb_t *comb = this->combs[i];
+        if(comb->type != COMB_JUST || comb->parse != (parse_f)parse_op) continue;
+        closure_env_t *env = comb->env;
+        if(env->is_op != is_op || env->sym != sym) continue;
+        emitf(out, "  if(lexer_add_%s(lexer, ", is_op ? "op" : "key");
+        gen_str(this, env->ref);
+        emitf(out, ") != %d) panic(\"generated parser out of date\");\n", sym);
+        break;
+      }
+    }
+  }
+  emit_line(out, "}");
+  emit_line(out, "");
+}
+
+void gen_parser(parser_t *parser, output_t *out) {
+  if(!parser->base) panic("no grammar to generate a parser from");
+  gen_t gen = { out, parser->lexer, 0, 0, 0 };
+  comb_walk(parser->base, (comb_walk_f)gen_collect, &gen);
+  emit_line(out, "// generated by comp --gen-parser | do not edit");
+  emit_line(out, "");
+  emit_line(out, "static inline int gen_class(lexer_t *lexer) {");
+  emit_line(out, "  token_t *tok = lexer_peek(lexer);");
+  emit_line(out, "  return tok->kind == TOK_OP ? TOK_ERR + 1 + tok->sym : tok->kind;");
+  emit_line(out, "}");
+  emit_line(out, "");
+  emit_line(out, "static inline node_t *gen_match(lexer_t *lexer, token_e kind, int sym, node_type type) {");
+  emit_line(out, "  token_t *tok = lexer_peek(lexer);");
+  emit_line(out, "  if(tok->kind != kind || tok->sym != sym) return 0;");
+  emit_line(out, "  lexer_next(lexer);");
+  emit_line(out, "  return node_new(type);");
+  emit_line(out, "}");
+  emit_line(out, "");
+  emit_line(out, "// elements of the lists being parsed");
+  emit_line(out, "static node_t **gen_values;");
+  emit_line(out, "static ulong  gen_value_len, gen_value_cap;");
+  emit_line(out, "");
+  emit_line(out, "static inline void gen_push(node_t *node) {");
+  emit_line(out, "  gen_values = grow(gen_values, &gen_value_cap, gen_value_len, sizeof(node_t*));");
+  emit_line(out, "  gen_values[gen_value_len++] = node;");
+  emit_line(out, "}");
+  emit_line(out, "");
+  for(ulong i = 0; i < gen.len; i++) {
+    if(gen.combs[i]->type == COMB_JUST) continue;
+    emit(out, "static node_t *");
+    gen_name(&gen, gen.combs[i]);
+    emit_line(out, "(lexer_t *lexer);");
+  }
+  emit_line(out, "");
+  for(ulong i = 0; i < gen.len; i++) {
+    if(gen.combs[i]->type != COMB_JUST) gen_rule(&gen, gen.combs[i]);
+  }
+  gen_init(&gen);
+  emit_line(out, "node_t *gen_parse(lexer_t *lexer) {");
+  emit(out, "  return ");
+  gen_ref(&gen, parser->base);
+  emit_line(out, ";");
+  emit_line(out, "}");
+  dealloc(gen.combs);
+}
+
 //---------------------------------------
 //---------------------------------------
 
 // -- UTIL ------------------------------
 
-typedef void (*stack_emit_f)(void*, output_t*);
-void stack_emit(stack_t *this, output_t *out, stack_emit_f emit_f) {
-  for(void *obj = 0; (obj = stack_next(&this));) {
-    emit_f(obj, out);
+typedef void (*kids_emit_f)(node_t*, output_t*);
+void kids_emit(node_t *this, output_t *out, kids_emit_f emit_f) {
+  for(node_t *kid = this->kids; kid < this->kids + this->len; kid++) {
+    emit_f(kid, out);
   }
 }
 
 void char_emit(node_t *this, output_t *out) {
-  emitf(out, "%c",  ((char_t*)this->node)->val);
+  emit_char(out, this->cval);
 }
 
 void charl_emit(node_t *this, output_t *out) {
@@ -902,11 +3115,34 @@ void charl_emit(node_t *this, output_t *out) {
 }
 
 void int_emit(node_t *this, output_t *out) {
-  emitf(out, "%d", ((int_t*)this->node)->val);
+  emit_int(out, this->ival);
+}
+
+void float_emit(node_t *this, output_t *out) {
+  emit_float(out, this->fval);
 }
 
 void str_emit(node_t *this, output_t *out) {
-  emit(out, ((str_t*)this->node)->val);
+  emit(out, this->str->val);
+}
+
+// #line of the first token of this that is kept in the tree | only
+// with --line-directives
+void line_emit(node_t *this, output_t *out) {
+  if(!out->lines) return;
+  // the primitives are the only nodes with a position
+  while(this->type >= 0) {
+    if(!this->len || !this->kids) return;
+    this = &this->kids[0];
+  }
+  emit(out, "#line ");
+  emit_int(out, input_line(out->lines, this->pos));
+  emit(out, " \"");
+  for(char *c = out->name; *c; c++) {
+    if(*c == '"' || *c == '\\') emit_char(out, '\\');
+    emit_char(out, *c);
+  }
+  emit_line(out, "\"");
 }
 
 void strl_emit(node_t *this, output_t *out) {
@@ -931,6 +3167,7 @@ void fun_decl_emit(node_t *this, output_t *out);
 void fun_emit(node_t *this, output_t *out);
 void stm_emit(node_t *this, output_t *out);
 void exp_emit(node_t *this, output_t *out);
+
 // --  ----------------------------------
 #define PTR_NODE          1
 #define VAR_DEF_NODE      2
@@ -985,107 +3222,562 @@ void exp_emit(node_t *this, output_t *out);
 #define RET_NODE          43
 #define EXTERN_NODE       44
 
-// -- TYPE ------------------------------
+// -- ACCESSORS -------------------------
+
+// children of the inner nodes by name | punctuation and keywords are
+// not part of the tree (see drop), lists hold their elements only
+
+#define var_decl_var(n)       (&(n)->kids[0])
+#define var_id(n)             (&(n)->kids[0])
+#define var_type(n)           (&(n)->kids[1])
+#define var_def_var(n)        (&(n)->kids[0])
+#define var_def_exp(n)        (&(n)->kids[1])
+#define struct_id(n)          (&(n)->kids[0])  // also STRUCT_DECL_NODE
+#define struct_vars(n)        (&(n)->kids[1])
+#define fun_id(n)             (&(n)->kids[0])  // also FUN_DECL_NODE
+#define fun_decl_type(n)      (&(n)->kids[1])
+#define fun_params(n)         (&(n)->kids[1])
+#define fun_type(n)           (&(n)->kids[2])
+#define fun_vars(n)           (&(n)->kids[3])
+#define fun_body(n)           (&(n)->kids[4])
 
-// ID_TYPE_NODE: 
-//  | STR
-// PTR_TYPE_NODE: 
-//  | *
-//  | TYPE
-// FUN_TYPE_NODE: 
-//  | ( 
-//  | | TYPE
-//  | | ...
-//  | )
-//  | ->
-//  | TYPE
-// ARR_TYPE_NODE: 
-//  | [
-//  | EXP
-//  | ;
-//  | EXP
-//  | ]
+// TYPES
+#define id_type_id(n)         (&(n)->kids[0])
+#define ptr_type_elem(n)      (&(n)->kids[0])
+#define fun_type_params(n)    (&(n)->kids[0])
+#define fun_type_ret(n)       (&(n)->kids[1])
+#define arr_type_elem(n)      (&(n)->kids[0])
+#define arr_type_size(n)      (&(n)->kids[1])
 
-void type_emit_head(node_t *this, output_t *out) {
-  stack_t *stack = this->node;
-  switch(this->type) {
-    case ID_TYPE_NODE:
-      str_emit(stack_next(&stack), out);
+// STATEMENTS
+#define exp_stm_exp(n)        (&(n)->kids[0])
+#define label_stm_id(n)       (&(n)->kids[0])
+#define jmp_con_stm_exp(n)    (&(n)->kids[0])
+#define jmp_con_stm_label(n)  (&(n)->kids[1])
+#define jmp_stm_label(n)      (&(n)->kids[0])
+#define ret_stm_exp(n)        (&(n)->kids[0])
+
+// EXPRESSIONS
+#define exp_val(n)            (&(n)->kids[0])  // INT ID STR FLOAT CHAR
+#define call_exp_list(n)      (&(n)->kids[0])
+
+// LISTS
+#define list_at(n, i)         (&(n)->kids[i])
+
+// -- BUILTINS --------------------------
+
+// call expressions with one of these heads are written as the c operator
+// they stand for. the operands go between pre, mid and post. with a
+// prelude they stay calls of the macro def instead
+
+// the operators that are worked out on literal operands while transpiling
+typedef enum fold_e {
+  FOLD_NONE,
+  FOLD_POS, FOLD_NEG, FOLD_BNOT, FOLD_NOT,
+  FOLD_ADD, FOLD_SUB, FOLD_MUL, FOLD_DIV, FOLD_MOD,
+  FOLD_AND, FOLD_OR,
+  FOLD_LT, FOLD_GT, FOLD_EQ, FOLD_LEQ, FOLD_GEQ,
+  FOLD_BAND, FOLD_BOR, FOLD_BXOR, FOLD_LS, FOLD_RS,
+} fold_e;
+
+typedef struct builtin_t {
+  char *name;
+  int  arity;  // -1: any number | a list with ", " between them
+  int  swap;   // the second operand comes first
+  char *pre, *mid, *post;
+  char *def;   // the macro that does the same after "#define <name>"
+  fold_e fold;
+} builtin_t;
+
+const builtin_t builtins[] = {
+  { "set",  2,  0, "(",        " = ",  ")",    "(lexp, rexp)  (lexp = rexp)" },
+  { "ref",  1,  0, "(&",       0,      ")",    "(exp)         (&exp)" },
+  { "deref",1,  0, "(*",       0,      ")",    "(exp)       (*exp)" },
+  { "get",  2,  0, "(",        ".",    ")",    "(lexp, rexp)  (lexp.rexp)" },
+  { "pget", 2,  0, "(",        "->",   ")",    "(lexp, rexp) (lexp->rexp)" },
+  { "aget", 2,  0, "(",        "[",    "])",   "(exp, index) (exp[index])" },
+  { "cast", 2,  1, "((",       ")",    ")",    "(exp, type)  ((type)exp)" },
+  { "size", 1,  0, "(sizeof(", 0,      "))",   "(exp)        (sizeof(exp))" },
+  { "lst",  -1, 0, "( ",       0,      " )",   "(...)         ( __VA_ARGS__ )" },
+  { "init", -1, 0, "{ ",       0,      " }",   "(...)        { __VA_ARGS__ }" },
+  // UNARY_OPERATORS
+  { "inc",  1,  0, "(",        0,      "++)",  "(exp)         (exp++)" },
+  { "dec",  1,  0, "(",        0,      "--)",  "(exp)         (exp--)" },
+  { "pos",  1,  0, "(+",       0,      ")",    "(exp)         (+exp)", FOLD_POS },
+  { "neg",  1,  0, "(-",       0,      ")",    "(exp)         (-exp)", FOLD_NEG },
+  { "bnot", 1,  0, "(~",       0,      ")",    "(exp)        (~exp)", FOLD_BNOT },
+  { "not",  1,  0, "(!",       0,      ")",    "(exp)         (!exp)", FOLD_NOT },
+  // BINARY_OPERATORS
+  { "add",  2,  0, "(",        " + ",  ")",    "(lexp, rexp)  (lexp + rexp)", FOLD_ADD },
+  { "sub",  2,  0, "(",        " - ",  ")",    "(lexp, rexp)  (lexp - rexp)", FOLD_SUB },
+  { "mul",  2,  0, "(",        " * ",  ")",    "(lexp, rexp)  (lexp * rexp)", FOLD_MUL },
+  { "div",  2,  0, "(",        " / ",  ")",    "(lexp, rexp)  (lexp / rexp)", FOLD_DIV },
+  { "and",  2,  0, "(",        " && ", ")",    "(lexp, rexp)  (lexp && rexp)", FOLD_AND },
+  { "or",   2,  0, "(",        " || ", ")",    "(lexp, rexp)   (lexp || rexp)", FOLD_OR },
+  { "mod",  2,  0, "(",        " % ",  ")",    "(lexp, rexp)  (lexp % rexp)", FOLD_MOD },
+  { "lt",   2,  0, "(",        " < ",  ")",    "(lexp, rexp)   (lexp < rexp)", FOLD_LT },
+  { "gt",   2,  0, "(",        " > ",  ")",    "(lexp, rexp)   (lexp > rexp)", FOLD_GT },
+  { "eq",   2,  0, "(",        " == ", ")",    "(lexp, rexp)   (lexp == rexp)", FOLD_EQ },
+  { "leq",  2,  0, "(",        " <= ", ")",    "(lexp, rexp)  (lexp <= rexp)", FOLD_LEQ },
+  { "geq",  2,  0, "(",        " >= ", ")",    "(lexp, rexp)  (lexp >= rexp)", FOLD_GEQ },
+  { "band", 2,  0, "(",        " & ",  ")",    "(lexp, rexp) (lexp & rexp)", FOLD_BAND },
+  { "bor",  2,  0, "(",        " | ",  ")",    "(lexp, rexp)  (lexp | rexp)", FOLD_BOR },
+  { "bxor", 2,  0, "(",        " ^ ",  ")",    "(lexp, rexp) (lexp ^ rexp)", FOLD_BXOR },
+  { "ls",   2,  0, "(",        " << ", ")",    "(lexp, rexp)   (lexp << rexp)", FOLD_LS },
+  { "rs",   2,  0, "(",        " >> ", ")",    "(lexp, rexp)   (lexp >> rexp)", FOLD_RS },
+};
+
+#define BUILTIN_COUNT (sizeof(builtins) / sizeof(builtins[0]))
+
+// marks the interned names of the builtins | the head of a call is
+// looked up without comparing a single char
+void builtin_intern() {
+  for(int i = 0; i < BUILTIN_COUNT; i++) {
+    intern(builtins[i].name, strlen(builtins[i].name))->builtin = i + 1;
+  }
+}
+
+// the builtin at the head of a call with the list exps | 0
+const builtin_t *builtin_of(node_t *exps) {
+  node_t *head = list_at(exps, 0);
+  if(head->type != ID_EXP_NODE) return 0;
+  int i = exp_val(head)->str->builtin;
+  return i ? &builtins[i - 1] : 0;
+}
+
+// 1 if a call with the list exps is written as a c operator | a wrong
+// number of operands stays a call
+int builtin_lower(const builtin_t *this, node_t *exps, output_t *out) {
+  return this && !out->prelude && (this->arity < 0 || this->arity == exps->len - 1);
+}
+
+void builtin_def_emit(const builtin_t *this, output_t *out) {
+  emit(out, "#define ");
+  emit(out, this->name);
+  emit_line(out, this->def);
+}
+
+// -- PRELUDE ---------------------------
+
+// PRELUDE_USED defines the macros of the builtins an item calls in front
+// of it, each once per output. PRELUDE_HEADER includes a header with all
+// of them that is shared by every output in the directory
+
+#define PRELUDE_NONE   0
+#define PRELUDE_USED   1
+#define PRELUDE_HEADER 2
+
+#define PRELUDE_HEADER_NAME "muon_prelude.h"
+
+// defines the macros item calls that are not defined yet
+void prelude_item_emit(node_t *item, output_t *out) {
+  node_t **stack = 0;
+  ulong len = 0, cap = 0;
+  stack = grow(stack, &cap, len, sizeof(node_t*));
+  stack[len++] = item;
+  while(len) {
+    node_t *node = stack[--len];
+    // the primitives have no children | len is their position
+    if(node->type < 0) continue;
+    if(node->type == CALL_EXP_NODE) {
+      const builtin_t *b = builtin_of(call_exp_list(node));
+      uint64_t bit = b ? 1ull << (b - builtins) : 0;
+      if(bit && !(out->defined & bit)) {
+        out->defined |= bit;
+        builtin_def_emit(b, out);
+      }
+    }
+    for(ulong i = 0; i < node->len; i++) {
+      stack = grow(stack, &cap, len, sizeof(node_t*));
+      stack[len++] = &node->kids[i];
+    }
+  }
+  dealloc(stack);
+}
+
+// writes PRELUDE_HEADER_NAME into the directory of path | an up to
+// date header is left alone, so builds do not see it change
+void prelude_header_write(char *path) {
+  char *slash = path ? strrchr(path, '/') : 0;
+  ulong dir = slash ? slash - path + 1 : 0;
+  char *name = alloc(dir + sizeof(PRELUDE_HEADER_NAME));
+  memcpy(name, path, dir);
+  strcpy(name + dir, PRELUDE_HEADER_NAME);
+
+  char *text = 0;
+  size_t text_len = 0;
+  output_t *out = output_new(open_memstream(&text, &text_len));
+  emit_line(out, "#ifndef MUON_PRELUDE_H");
+  emit_line(out, "#define MUON_PRELUDE_H");
+  for(int i = 0; i < BUILTIN_COUNT; i++) builtin_def_emit(&builtins[i], out);
+  emit_line(out, "#endif");
+  output_free(out);
+
+  FILE *file = fopen(name, "r");
+  int same = 0;
+  if(file) {
+    char *old = alloc(text_len + 1);
+    same = fread(old, 1, text_len + 1, file) == text_len && !memcmp(old, text, text_len);
+    dealloc(old);
+    fclose(file);
+  }
+  if(!same) {
+    if(!(file = fopen(name, "w"))) panic("unable to open %s", name);
+    if(fwrite(text, 1, text_len, file) != text_len || fclose(file) == EOF) error("unable to write %s", name);
+  }
+  free(text);
+  dealloc(name);
+}
+
+// -- FOLDING ---------------------------
+
+// calls of the operators above with literal operands are replaced by the
+// literal they give before the item is emitted, so sizes of arrays at
+// file scope stay constant and the c compiler sees less. the value is the
+// one the c code would have | a call that overflows, divides by zero or
+// has no exact literal is kept
+
+typedef struct fold_val_t {
+  int    is_float;
+  long   ival;
+  double fval;
+} fold_val_t;
+
+// the value of a literal expression as c reads it from the output | 0
+int fold_val(node_t *exp, fold_val_t *val) {
+  switch(exp->type) {
+    case INT_EXP_NODE:
+      *val = (fold_val_t){ 0, exp_val(exp)->ival, 0 };
+      return 1;
+    case CHAR_EXP_NODE:
+      *val = (fold_val_t){ 0, exp_val(exp)->cval, 0 };
+      return 1;
+    case FLOAT_EXP_NODE: {
+      // floats are written with six decimals
+      char text[512];
+      snprintf(text, sizeof(text), "%f", exp_val(exp)->fval);
+      *val = (fold_val_t){ 1, 0, strtod(text, 0) };
+      return 1;
+    }
+  }
+  return 0;
+}
+
+// res is op applied to a and b as a c int expression | 0 if it has no
+// defined int result
+int fold_int(fold_e op, long a, long b, long *res) {
+  switch(op) {
+    case FOLD_POS:  *res = a; break;
+    case FOLD_NEG:  *res = -a; break;
+    case FOLD_BNOT: *res = ~a; break;
+    case FOLD_NOT:  *res = !a; break;
+    case FOLD_ADD:  *res = a + b; break;
+    case FOLD_SUB:  *res = a - b; break;
+    case FOLD_MUL:  *res = a * b; break;
+    case FOLD_DIV:  if(!b) return 0; *res = a / b; break;
+    case FOLD_MOD:  if(!b) return 0; *res = a % b; break;
+    case FOLD_AND:  *res = a && b; break;
+    case FOLD_OR:   *res = a || b; break;
+    case FOLD_LT:   *res = a < b; break;
+    case FOLD_GT:   *res = a > b; break;
+    case FOLD_EQ:   *res = a == b; break;
+    case FOLD_LEQ:  *res = a <= b; break;
+    case FOLD_GEQ:  *res = a >= b; break;
+    case FOLD_BAND: *res = a & b; break;
+    case FOLD_BOR:  *res = a | b; break;
+    case FOLD_BXOR: *res = a ^ b; break;
+    // shifting a negative value or by the width of an int is undefined
+    case FOLD_LS:   if(a < 0 || b < 0 || b > 31) return 0; *res = a << b; break;
+    case FOLD_RS:   if(a < 0 || b < 0 || b > 31) return 0; *res = a >> b; break;
+    default:        return 0;
+  }
+  // INT_MIN is left out too | a negative literal behind "(-" would read
+  // as "--"
+  return *res > INT_MIN && *res <= INT_MAX;
+}
+
+// res is op applied to a and b with one of them a double | 0 for the
+// int only operators
+int fold_float(fold_e op, double a, double b, fold_val_t *res) {
+  *res = (fold_val_t){ 1, 0, 0 };
+  switch(op) {
+    case FOLD_POS: res->fval = a; break;
+    case FOLD_NEG: res->fval = -a; break;
+    case FOLD_ADD: res->fval = a + b; break;
+    case FOLD_SUB: res->fval = a - b; break;
+    case FOLD_MUL: res->fval = a * b; break;
+    case FOLD_DIV: if(b == 0) return 0; res->fval = a / b; break;
+    case FOLD_NOT: *res = (fold_val_t){ 0, !a, 0 }; return 1;
+    case FOLD_AND: *res = (fold_val_t){ 0, a && b, 0 }; return 1;
+    case FOLD_OR:  *res = (fold_val_t){ 0, a || b, 0 }; return 1;
+    case FOLD_LT:  *res = (fold_val_t){ 0, a < b, 0 }; return 1;
+    case FOLD_GT:  *res = (fold_val_t){ 0, a > b, 0 }; return 1;
+    case FOLD_EQ:  *res = (fold_val_t){ 0, a == b, 0 }; return 1;
+    case FOLD_LEQ: *res = (fold_val_t){ 0, a <= b, 0 }; return 1;
+    case FOLD_GEQ: *res = (fold_val_t){ 0, a >= b, 0 }; return 1;
+    default:       return 0;
+  }
+  // the result has to survive being written with six decimals
+  char text[512];
+  if(!isfinite(res->fval)) return 0;
+  snprintf(text, sizeof(text), "%f", res->fval);
+  return strtod(text, 0) == res->fval;
+}
+
+// replaces the call node with the literal it gives | 0 if it is kept
+int fold_call(node_t *node) {
+  node_t *exps = call_exp_list(node);
+  if(!exps->len) return 0;
+  const builtin_t *b = builtin_of(exps);
+  if(!b || !b->fold || b->arity != exps->len - 1) return 0;
+
+  fold_val_t a, c = { 0, 0, 0 }, res = { 0, 0, 0 };
+  if(!fold_val(list_at(exps, 1), &a)) return 0;
+  if(b->arity == 2 && !fold_val(list_at(exps, 2), &c)) return 0;
+  if(a.is_float || c.is_float) {
+    if(!fold_float(b->fold, a.is_float ? a.fval : a.ival, c.is_float ? c.fval : c.ival, &res)) return 0;
+  } else if(!fold_int(b->fold, a.ival, c.ival, &res.ival)) {
+    return 0;
+  }
+
+  // the literal takes the position of the head for the line directives
+  node_t *leaf = node_new(res.is_float ? FLOAT_NODE : INT_NODE);
+  leaf->pos = exp_val(list_at(exps, 0))->pos;
+  if(res.is_float) leaf->fval = res.fval;
+  else leaf->ival = res.ival;
+  *node = *node_build(res.is_float ? FLOAT_EXP_NODE : INT_EXP_NODE, &leaf, 1);
+  return 1;
+}
+
+// folds the calls of item from the innermost out, so (mul 4 (add 16 16))
+// becomes 128 | a call is pushed again below its children and folded
+// when it comes up the second time
+
+typedef struct fold_task_t {
+  node_t *node;
+  int    done;
+} fold_task_t;
+
+void fold_item(node_t *item) {
+  fold_task_t *stack = 0;
+  ulong len = 0, cap = 0;
+  stack = grow(stack, &cap, len, sizeof(fold_task_t));
+  stack[len++] = (fold_task_t){ item, 0 };
+  while(len) {
+    fold_task_t task = stack[--len];
+    node_t *node = task.node;
+    if(task.done) {
+      fold_call(node);
+      continue;
+    }
+    if(node->type < 0) continue;
+    if(node->type == CALL_EXP_NODE) {
+      stack = grow(stack, &cap, len, sizeof(fold_task_t));
+      stack[len++] = (fold_task_t){ node, 1 };
+    }
+    for(ulong i = 0; i < node->len; i++) {
+      stack = grow(stack, &cap, len, sizeof(fold_task_t));
+      stack[len++] = (fold_task_t){ &node->kids[i], 0 };
+    }
+  }
+  dealloc(stack);
+}
+
+// -- EMIT_STACK ------------------------
+
+// types and expressions nest without bound, so they are emitted from
+// an explicit stack of tasks instead of recursing | tasks are pushed in
+// reverse order of their output
+
+typedef enum emit_e {
+  EMIT_TEXT,     // obj is a const char*
+  EMIT_EXP,
+  EMIT_TYPE,
+  EMIT_HEAD,
+  EMIT_TAIL,
+  EMIT_EXP_LIST, // obj is the list node | ", " between elements
+  EMIT_TYPE_LIST,
+} emit_e;
+
+typedef struct emit_task_t {
+  emit_e kind;
+  void   *obj;
+  ulong  next;   // lists: index of the next element
+  int    first;
+} emit_task_t;
+
+typedef struct emit_stack_t {
+  emit_task_t *tasks;
+  ulong       len, cap;
+} emit_stack_t;
+
+void emit_push(emit_stack_t *this, emit_e kind, void *obj) {
+  this->tasks = grow(this->tasks, &this->cap, this->len, sizeof(emit_task_t));
+  this->tasks[this->len++] = (emit_task_t){ kind, obj, 0, 1 };
+}
+
+void emit_exp_task(emit_stack_t *this, node_t *node, output_t *out) {
+  switch(node->type) {
+    case INT_EXP_NODE:
+      int_emit(exp_val(node), out);
       break;
-    case PTR_TYPE_NODE: {
-      stack_next(&stack); // *
-      type_emit_head(stack_next(&stack), out);
-      emit(out, "*");
+    case ID_EXP_NODE:
+      str_emit(exp_val(node), out);
       break;
-    }
-    case FUN_TYPE_NODE: {
-      stack_next(&stack); // (
-      stack_next(&stack); // stack_t
-      stack_next(&stack); // )
-      stack_next(&stack); // ->
-      type_emit(stack_next(&stack), out);
-      emit(out, "(*");
+    case STR_EXP_NODE:
+      strl_emit(exp_val(node), out);
       break;
-    }
-    case ARR_TYPE_NODE: {
-      stack_next(&stack); // [
-      type_emit_head(stack_next(&stack), out);
+    case FLOAT_EXP_NODE:
+      float_emit(exp_val(node), out);
+      break;
+    case CHAR_EXP_NODE:
+      charl_emit(exp_val(node), out);
+      break;
+    case CALL_EXP_NODE: {
+      node_t *exps = call_exp_list(node);
+      if(!exps->len) {
+        error("invalid function call exp");
+        break;
+      }
+      const builtin_t *b = builtin_of(exps);
+      if(!builtin_lower(b, exps, out)) {
+        emit_push(this, EMIT_TEXT, ")");
+        emit_push(this, EMIT_EXP_LIST, exps);
+        this->tasks[this->len - 1].next = 1;
+        emit_push(this, EMIT_TEXT, "(");
+        emit_push(this, EMIT_EXP, list_at(exps, 0));
+        break;
+      }
+      emit(out, b->pre);
+      emit_push(this, EMIT_TEXT, b->post);
+      if(b->arity < 0) {
+        emit_push(this, EMIT_EXP_LIST, exps);
+        this->tasks[this->len - 1].next = 1;
+      } else if(b->arity == 1) {
+        emit_push(this, EMIT_EXP, list_at(exps, 1));
+      } else {
+        emit_push(this, EMIT_EXP, list_at(exps, b->swap ? 1 : 2));
+        emit_push(this, EMIT_TEXT, b->mid);
+        emit_push(this, EMIT_EXP, list_at(exps, b->swap ? 2 : 1));
+      }
       break;
     }
   }
 }
 
-void type_emit_tail(node_t *this, output_t *out) {
-  stack_t *stack = this->node;
-  switch(this->type) {
+void emit_head_task(emit_stack_t *this, node_t *node, output_t *out) {
+  switch(node->type) {
+    case ID_TYPE_NODE:
+      str_emit(id_type_id(node), out);
+      break;
+    case PTR_TYPE_NODE:
+      emit_push(this, EMIT_TEXT, "*");
+      emit_push(this, EMIT_HEAD, ptr_type_elem(node));
+      break;
+    case FUN_TYPE_NODE:
+      emit_push(this, EMIT_TEXT, "(*");
+      emit_push(this, EMIT_TYPE, fun_type_ret(node));
+      break;
+    case ARR_TYPE_NODE:
+      emit_push(this, EMIT_HEAD, arr_type_elem(node));
+      break;
+  }
+}
+
+void emit_tail_task(emit_stack_t *this, node_t *node, output_t *out) {
+  switch(node->type) {
     case ID_TYPE_NODE:
       break;
     case PTR_TYPE_NODE:
-      stack_next(&stack); // *
-      type_emit_tail(stack_next(&stack), out);
+      emit_push(this, EMIT_TAIL, ptr_type_elem(node));
       break;
-    case ARR_TYPE_NODE: {
-      stack_next(&stack); // [
-      node_t *n = stack_next(&stack);
-      stack_next(&stack); // ;
+    case ARR_TYPE_NODE:
       emit(out, "[");
-      exp_emit(stack_next(&stack), out);
-      emit(out, "]");
-      type_emit_tail(n, out);
+      emit_push(this, EMIT_TAIL, arr_type_elem(node));
+      emit_push(this, EMIT_TEXT, "]");
+      emit_push(this, EMIT_EXP, arr_type_size(node));
       break;
-    }
-    case FUN_TYPE_NODE: {
-      stack_next(&stack); // (
-      stack = node_unwrap(stack_next(&stack)); 
+    case FUN_TYPE_NODE:
       emit(out, ")(");
-      node_t *obj = stack_next(&stack);
-      while(obj) {
-        type_emit(obj, out);
-        if((obj = stack_next(&stack))) emit(out, ", ");
-      }
-      emit(out, ")");
+      emit_push(this, EMIT_TEXT, ")");
+      emit_push(this, EMIT_TYPE_LIST, fun_type_params(node));
       break;
+  }
+}
+
+void emit_run(emit_e kind, node_t *node, output_t *out) {
+  emit_stack_t stack = { 0, 0, 0 };
+  emit_push(&stack, kind, node);
+  while(stack.len) {
+    emit_task_t task = stack.tasks[--stack.len];
+    switch(task.kind) {
+      case EMIT_TEXT:
+        emit(out, task.obj);
+        break;
+      case EMIT_EXP:
+        emit_exp_task(&stack, task.obj, out);
+        break;
+      case EMIT_TYPE:
+        emit_push(&stack, EMIT_TAIL, task.obj);
+        emit_push(&stack, EMIT_HEAD, task.obj);
+        break;
+      case EMIT_HEAD:
+        emit_head_task(&stack, task.obj, out);
+        break;
+      case EMIT_TAIL:
+        emit_tail_task(&stack, task.obj, out);
+        break;
+      case EMIT_EXP_LIST:
+      case EMIT_TYPE_LIST: {
+        node_t *list = task.obj;
+        if(task.next >= list->len) break;
+        if(!task.first) emit(out, ", ");
+        // the rest of the list resumes after the element
+        emit_push(&stack, task.kind, list);
+        stack.tasks[stack.len - 1].next  = task.next + 1;
+        stack.tasks[stack.len - 1].first = 0;
+        emit_push(&stack, task.kind == EMIT_EXP_LIST ? EMIT_EXP : EMIT_TYPE, list_at(list, task.next));
+        break;
+      }
     }
   }
+  dealloc(stack.tasks);
+}
+
+// -- TYPE ------------------------------
+
+// ID_TYPE_NODE: 
+//  | STR
+// PTR_TYPE_NODE: 
+//  | TYPE
+// FUN_TYPE_NODE: 
+//  | | TYPE
+//  | | ...
+//  | TYPE
+// ARR_TYPE_NODE: 
+//  | TYPE
+//  | EXP
+
+void type_emit_head(node_t *this, output_t *out) {
+  emit_run(EMIT_HEAD, this, out);
+}
+
+void type_emit_tail(node_t *this, output_t *out) {
+  emit_run(EMIT_TAIL, this, out);
 }
 
 void type_emit(node_t *this, output_t *out) {
-  type_emit_head(this, out);
-  type_emit_tail(this, out);
+  emit_run(EMIT_TYPE, this, out);
 }
 
 // -- VAR_DECL --------------------------
 
 // VAR_DECL_NODE:
-//  | extern
 //  | VAR
-//  | semicolon
 
 void var_decl_emit(node_t *this, output_t *out) {
-  stack_t *stack = this->node;
-  stack_next(&stack);
   emit(out, "extern ");
-  var_emit(stack_next(&stack), out);
+  var_emit(var_decl_var(this), out);
   emit_line(out, ";");
 }
 
@@ -1093,14 +3785,11 @@ void var_decl_emit(node_t *this, output_t *out) {
 
 // VAR_NODE:
 //  | STR
-//  | :
 //  | TYPE
 
 void var_emit(node_t *this, output_t *out) {
-  stack_t *stack = this->node;
-  node_t *id_node = stack_next(&stack);
-  stack_next(&stack); // :
-  node_t *type_node = stack_next(&stack);
+  node_t *id_node   = var_id(this);
+  node_t *type_node = var_type(this);
   type_emit_head(type_node, out);
   emit(out, " ");
   str_emit(id_node, out);
@@ -1112,11 +3801,9 @@ void var_emit(node_t *this, output_t *out) {
 
 // STRUCT_DECL_NODE:
 //  | STR
-//  | ;
 
 void struct_decl_emit(node_t *this, output_t *out) {
-  stack_t *stack = this->node;
-  node_t *id_node = stack_next(&stack);
+  node_t *id_node = struct_id(this);
   emit(out, "typedef struct ");
   str_emit(id_node, out);
   emit(out, " ");
@@ -1128,10 +3815,8 @@ void struct_decl_emit(node_t *this, output_t *out) {
 
 // STRUCT_NODE:
 //  | STR
-//  | {
 //  | | VAR
 //  | | ...
-//  | }
 
 void var_member_emit(node_t *this, output_t *out) {
   var_emit(this, out);
@@ -1139,10 +3824,8 @@ void var_member_emit(node_t *this, output_t *out) {
 }
 
 void struct_emit(node_t *this, output_t *out) {
-  stack_t *stack = this->node;
-  node_t *id_node = stack_next(&stack);
-  stack_next(&stack);
-  stack_t *var_stack = node_unwrap(stack_next(&stack));
+  node_t *id_node  = struct_id(this);
+  node_t *var_list = struct_vars(this);
   emit(out, "typedef struct ");
   str_emit(id_node, out);
   emit(out, " ");
@@ -1151,7 +3834,7 @@ void struct_emit(node_t *this, output_t *out) {
   emit(out, "typedef struct ");
   str_emit(id_node, out);
   emit_line(out, " {");
-  stack_emit(var_stack, out, (stack_emit_f)var_member_emit);
+  kids_emit(var_list, out, var_member_emit);
   emit(out, "} ");
   str_emit(id_node, out);
   emit_line(out, ";");
@@ -1161,31 +3844,21 @@ void struct_emit(node_t *this, output_t *out) {
 
 // FUN_DECL_NODE
 //  | STR
-//  | | (
 //  | | | TYPE
 //  | | | ...
-//  | | ) 
-//  | | -> 
 //  | | TYPE
-//  | | ;
 
 void fun_decl_emit(node_t *this, output_t *out) {
-  stack_t *stack = this->node;
-  node_t *id_node = stack_next(&stack);
-  stack_t *type_stack = node_unwrap(stack_next(&stack));
-  stack_next(&type_stack);
-  stack_t *param_stack = node_unwrap(stack_next(&type_stack));
-  stack_next(&type_stack);
-  stack_next(&type_stack);
-  node_t *type = stack_next(&type_stack);
+  node_t *id_node    = fun_id(this);
+  node_t *param_list = fun_type_params(fun_decl_type(this));
+  node_t *type       = fun_type_ret(fun_decl_type(this));
   type_emit_head(type, out);
   emit(out, " ");
   str_emit(id_node, out);
   emit(out, "(");
-  node_t *param = stack_next(&param_stack);
-  while(param) {
-    type_emit(param, out);
-    if((param = stack_next(&param_stack))) emit(out, ", ");
+  for(ulong i = 0; i < param_list->len; i++) {
+    if(i) emit(out, ", ");
+    type_emit(list_at(param_list, i), out);
   }
   emit(out, ")");
   type_emit_tail(type, out);
@@ -1196,30 +3869,22 @@ void fun_decl_emit(node_t *this, output_t *out) {
 
 // FUN_NODE:
 //  | STR
-//  | (
 //  | | VAR
 //  | | ...
-//  | )
-//  | ->
 //  | TYPE
 //  | | DECL
 //  | | ...
-//  | {
 //  | | STM
 //  | | ...
-//  | }
 
 // VAR_DEF_NODE:
 //  | VAR
-//  | =
 //  | EXP
-//  | ;
 
 void var_def_emit(node_t *this, output_t *out) {
-  stack_t *stack = this->node;
-  node_t *var_node = stack_next(&stack);
-  stack_next(&stack);
-  node_t *exp_node = stack_next(&stack);
+  node_t *var_node = var_def_var(this);
+  node_t *exp_node = var_def_exp(this);
+  line_emit(this, out);
   var_emit(var_node, out);
   emit(out, " = ");
   exp_emit(exp_node, out);
@@ -1227,31 +3892,25 @@ void var_def_emit(node_t *this, output_t *out) {
 }
 
 void fun_emit(node_t *this, output_t *out) {
-  stack_t *stack = this->node;
-  node_t *id_node = stack_next(&stack);
-  stack_next(&stack);
-  stack_t *var_stack = node_unwrap(stack_next(&stack));
-  stack_next(&stack);
-  stack_next(&stack);
-  node_t *type_node = stack_next(&stack);
-  stack_t *var_def_stack = node_unwrap(stack_next(&stack));
-  stack_next(&stack);
-  stack_t *stm_stack = node_unwrap(stack_next(&stack));
+  node_t *id_node      = fun_id(this);
+  node_t *var_list     = fun_params(this);
+  node_t *type_node    = fun_type(this);
+  node_t *var_def_list = fun_vars(this);
+  node_t *stm_list     = fun_body(this);
+  line_emit(this, out);
   type_emit_head(type_node, out);
   emit(out, " ");
   str_emit(id_node, out);
   emit(out, "(");
-  node_t *var = stack_next(&var_stack);
-  while(var) {
-    var_emit(var, out);
-    var = stack_next(&var_stack);
-    if(var) emit(out, ", ");
+  for(ulong i = 0; i < var_list->len; i++) {
+    if(i) emit(out, ", ");
+    var_emit(list_at(var_list, i), out);
   }
   emit(out, ")");
   type_emit_tail(type_node, out);
   emit_line(out, " {");
-  stack_emit(var_def_stack, out, (stack_emit_f)var_def_emit);
-  stack_emit(stm_stack, out, (stack_emit_f)stm_emit);
+  kids_emit(var_def_list, out, var_def_emit);
+  kids_emit(stm_list, out, stm_emit);
   emit_line(out, "}");
 }
 
@@ -1261,49 +3920,39 @@ void fun_emit(node_t *this, output_t *out) {
 //  ;
 // EXP_STM_NODE: 
 //  | EXP
-//  | ;
 // LABEL_STM_NODE: 
 //  | STR
-//  | :
 // JMP_CON_STM_NODE: 
-//  | jmp
 //  | EXP
 //  | STR
-//  | ;
 // JMP_STM_NODE: 
-//  | jmp
 //  | STR
-//  | ;
 // RET_STM_NODE: 
-//  | ret
 //  | EXP
-//  | ;
 
 void stm_emit(node_t *this, output_t *out) {
-  stack_t *stack = this->node;
+  line_emit(this, out);
   switch(this->type) {
     case SEMICOLON_NODE:
       break;
     case EXP_STM_NODE: 
-      exp_emit(stack_next(&stack), out);
+      exp_emit(exp_stm_exp(this), out);
       emit_line(out, ";");
       break;
     case LABEL_STM_NODE:
-      str_emit(stack_next(&stack), out);
+      str_emit(label_stm_id(this), out);
       emit_line(out, ":");
       break;
     case JMP_CON_STM_NODE:
       emit(out, "if(");
-      stack_next(&stack);
-      exp_emit(stack_next(&stack), out);
+      exp_emit(jmp_con_stm_exp(this), out);
       emit(out, ") goto ");
-      str_emit(stack_next(&stack), out);
+      str_emit(jmp_con_stm_label(this), out);
       emit_line(out, ";");
       break;
     case RET_STM_NODE:
       emit(out, "return ");
-      stack_next(&stack);
-      exp_emit(stack_next(&stack), out);
+      exp_emit(ret_stm_exp(this), out);
       emit_line(out, ";");
       break;
   }
@@ -1320,53 +3969,23 @@ void stm_emit(node_t *this, output_t *out) {
 // FLOAT_EXP: 
 //  | FLOAT
 // CALL_EXP: 
-//  | (
 //  | | EXP
 //  | | ...
-//  | )
 
 void exp_emit(node_t *this, output_t *out) {
-  stack_t *stack = this->node;
-  switch(this->type) {
-    case INT_EXP_NODE:
-      int_emit(stack_next(&stack), out);
-      break;
-    case ID_EXP_NODE:
-      str_emit(stack_next(&stack), out);
-      break;
-    case STR_EXP_NODE:
-      strl_emit(stack_next(&stack), out);
-      break;
-    case FLOAT_EXP_NODE:
-      float_emit(stack_next(&stack), out);
-      break;
-    case CHAR_EXP_NODE:
-      charl_emit(stack_next(&stack), out);
-    case CALL_EXP_NODE: {
-      stack_next(&stack);
-      stack_t *exp_stack = node_unwrap(stack_next(&stack));
-      node_t *exp = stack_next(&exp_stack);
-      if(!exp) {
-        error("invalid function call exp");
-        break;
-      }
-      exp_emit(exp, out);
-      emit(out, "(");
-      exp = stack_next(&exp_stack);
-      while(exp) {
-        exp_emit(exp, out);
-        exp = stack_next(&exp_stack);
-        if(exp) emit(out, ", ");
-      }
-      emit(out, ")");
-      break;       
-    }
-  }
+  emit_run(EMIT_EXP, this, out);
 }
 
 // --  ----------------------------------
 
 parser_t *parser_create(input_t *input) {
+  builtin_intern();
+#ifdef GEN_PARSER
+  // the grammar is compiled in | only the lexer needs its symbols
+  lexer_t *lexer = lexer_new(input);
+  gen_parser_init(lexer);
+  return parser_new(lexer, 0, 0);
+#else
   comb_t *base_comb         = comb_new();
   comb_t *struct_decl_comb  = comb_new();
   comb_t *struct_comb       = comb_new();
@@ -1409,24 +4028,24 @@ parser_t *parser_create(input_t *input) {
   comb_t *dot_exp_comb      = comb_new();
   comb_t *arrow_exp_comb    = comb_new();
 
-  // OPERATORS
-  comb_t *l_c_b_o           = match_op("{", L_C_B_NODE);
-  comb_t *r_c_b_o           = match_op("}", R_C_B_NODE);
-  comb_t *l_r_b_o           = match_op("(", L_R_B_NODE);
-  comb_t *r_r_b_o           = match_op(")", R_R_B_NODE);
-  comb_t *l_s_b_o           = match_op("[", L_S_B_NODE);
-  comb_t *r_s_b_o           = match_op("]", R_S_B_NODE);
-  comb_t *arrow_o           = match_op("->", ARROW_NODE);
-  comb_t *colon_o           = match_op(":", COLON_NODE);
-  comb_t *semicolon_o       = match_op(";", SEMICOLON_NODE);
-  comb_t *comma_o           = match_op(",", COMMA_NODE);
-  comb_t *eq_o              = match_op("=", EQ_NODE);
-  comb_t *as_o              = match_op("*", AS_NODE);
+  // OPERATORS | matched but not kept in the tree
+  comb_t *l_c_b_o           = drop(match_op("{", L_C_B_NODE));
+  comb_t *r_c_b_o           = drop(match_op("}", R_C_B_NODE));
+  comb_t *l_r_b_o           = drop(match_op("(", L_R_B_NODE));
+  comb_t *r_r_b_o           = drop(match_op(")", R_R_B_NODE));
+  comb_t *l_s_b_o           = drop(match_op("[", L_S_B_NODE));
+  comb_t *r_s_b_o           = drop(match_op("]", R_S_B_NODE));
+  comb_t *arrow_o           = drop(match_op("->", ARROW_NODE));
+  comb_t *colon_o           = drop(match_op(":", COLON_NODE));
+  comb_t *semicolon_o       = drop(match_op(";", SEMICOLON_NODE));
+  comb_t *comma_o           = drop(match_op(",", COMMA_NODE));
+  comb_t *eq_o              = drop(match_op("=", EQ_NODE));
+  comb_t *as_o              = drop(match_op("*", AS_NODE));
   
-  // KEYWORDS
-  comb_t *jmp_k             = match_key("jmp", JMP_NODE);
-  comb_t *ret_k             = match_key("ret", RET_NODE);
-  comb_t *extern_k          = match_key("extern", EXTERN_NODE);
+  // KEYWORDS | matched but not kept in the tree
+  comb_t *jmp_k             = drop(match_key("jmp", JMP_NODE));
+  comb_t *ret_k             = drop(match_key("ret", RET_NODE));
+  comb_t *extern_k          = drop(match_key("extern", EXTERN_NODE));
   
   
   // COMBINATOR STACK
@@ -1444,11 +4063,11 @@ parser_t *parser_create(input_t *input) {
 
 #define share comb_share
 #define MATCH_AND(comb, node_type, ...) \
-  comb = match_and(comb, node_type, stack_from(__VA_ARGS__, 0));
+  comb = comb_name(match_and(comb, node_type, stack_from(__VA_ARGS__, 0)), #comb);
 #define MATCH_OR(comb, ...) \
-  comb = match_or(comb, stack_from(__VA_ARGS__, 0));
+  comb = comb_name(match_or(comb, stack_from(__VA_ARGS__, 0)), #comb);
 #define MATCH_OPT(comb, node_type, elem, sep, sl) \
-  comb = match_opt(comb, node_type, elem, sep, sl);
+  comb = comb_name(match_opt(comb, node_type, elem, sep, sl), #comb);
   
   MATCH_AND(var_decl_comb,                                   // ________________________
             VAR_DECL_NODE,                                   // - VARIABLE_DECLARATION -
@@ -1563,7 +4182,8 @@ parser_t *parser_create(input_t *input) {
            share(label_stm_comb),                            // | LABEL_STM
            share(jmp_stm_comb),                              // | JMP_STM
            share(jmp_con_stm_comb),                          // | JMP_CON_STM
-           share(ret_stm_comb));                             // | RET_STM
+           share(ret_stm_comb),                              // | RET_STM
+           match_skip(SEMICOLON_NODE));                      // | error: skipped to ;
 
   MATCH_OPT(stm_list_comb,                                   // __________________
             STM_LIST_NODE,                                   // - STATEMENT_LIST -
@@ -1656,55 +4276,367 @@ parser_t *parser_create(input_t *input) {
 #undef COMB_OPT
 #undef share
 
-  return parser_new(input, comb_share(base_comb), comb_stack);
+  lexer_t *lexer = lexer_new(input);
+  comb_walk(base_comb, (comb_walk_f)parser_register_op, lexer);
+  comb_walk(base_comb, comb_factor, 0);
+  comb_analyze(base_comb);
+
+  return parser_new(lexer, comb_share(base_comb), comb_stack);
+#endif
+}
+
+//---------------------------------------
+// ITEMS
+//---------------------------------------
+
+// emits a parsed top-level item | 0 at the end of the input
+int item_emit(node_t *node, output_t *output) {
+  fold_item(node);
+  if(output->prelude == PRELUDE_USED) prelude_item_emit(node, output);
+  switch(node->type) {
+    case STRUCT_NODE: {
+      log("parsed struct");
+      struct_emit(node, output);
+      break;
+    }
+    case FUN_NODE: {
+      log("parsed function");
+      fun_emit(node, output);
+      break;
+    }
+    case STRUCT_DECL_NODE: {
+      log("parsed struct forward declaration");
+      struct_decl_emit(node, output);
+      break;
+    }
+    case VAR_DEF_NODE: {
+      log("parsed variable definition");
+      var_def_emit(node, output);
+      break;
+    }
+    case FUN_DECL_NODE: {
+      log("parsed function declaration");
+      fun_decl_emit(node, output);
+      break;
+    }
+    case VAR_DECL_NODE: {
+      log("parsed variable declaration");
+      var_decl_emit(node, output);
+      break;
+    }
+    case EOF_NODE:
+      return 0;
+    default:
+      panic("parsed undefined node");
+  }
+  return 1;
+}
+
+void parser_configure(parser_t *parser, int packrat, int vm) {
+  if(packrat) parser->memo = memo_new();
+  if(vm) {
+    if(!parser->base) panic("--vm needs the combinator grammar");
+    parser->vm = vm_new(parser->base);
+  }
+}
+
+//---------------------------------------
+// WATCH
+//---------------------------------------
+
+// keeps the byte range and the emitted c of every top-level item of
+// the last run. on a change only the items from the first changed
+// byte up to the first item boundary inside the unchanged tail are
+// parsed again. the lexer only carries its position from one item to
+// the next, so everything from such a boundary on lexes the same.
+// the output is rewritten from the first changed item on
+
+typedef struct item_t {
+  ulong  start;  // byte range in the source | up to the next item
+  ulong  end;
+  char   *text;  // emitted c
+  size_t len;
+} item_t;
+
+typedef struct watch_t {
+  char   *in_path;
+  char   *out_path;
+  int    packrat, vm, lines, prelude;
+  char   *src;       // source of the last run
+  ulong  src_len;
+  item_t *items;
+  ulong  len, cap;
+  struct stat st;    // of the source at the last run
+} watch_t;
+
+void watch_push(watch_t *this, item_t item) {
+  this->items = grow(this->items, &this->cap, this->len, sizeof(item_t));
+  this->items[this->len++] = item;
+}
+
+// 1 if the source changed on disk since the last check
+int watch_changed(watch_t *this) {
+  struct stat st;
+  if(stat(this->in_path, &st)) return 0;
+  int res = st.st_ino != this->st.st_ino || st.st_size != this->st.st_size
+         || st.st_mtim.tv_sec != this->st.st_mtim.tv_sec
+         || st.st_mtim.tv_nsec != this->st.st_mtim.tv_nsec;
+  this->st = st;
+  return res;
+}
+
+// writes the items from first up to last | the output around them stays
+void watch_write(watch_t *this, ulong first, ulong last, int all) {
+  FILE *file = fopen(this->out_path, all ? "w" : "r+");
+  if(!file) panic("unable to open output file");
+  // the include of the header is the only text that is not an item
+  char *head = this->prelude == PRELUDE_HEADER ? "#include \"" PRELUDE_HEADER_NAME "\"\n" : "";
+  long offset = strlen(head);
+  if(all) fputs(head, file);
+  for(ulong i = 0; i < first; i++) offset += this->items[i].len;
+  if(fseek(file, offset, SEEK_SET)) panic("unable to seek output file");
+  for(ulong i = first; i < last; i++) {
+    offset += fwrite(this->items[i].text, 1, this->items[i].len, file);
+  }
+  fflush(file);
+  if(last == this->len && ftruncate(fileno(file), offset)) error("unable to truncate output file");
+  fclose(file);
+}
+
+// parses the source again from the first item the change touched
+ulong watch_newlines(char *p, ulong n) {
+  ulong res = 0;
+  for(char *end = p + n; (p = memchr(p, '\n', end - p)); p++) res++;
+  return res;
+}
+
+void watch_update(watch_t *this) {
+  FILE *inf = fopen(this->in_path, "r");
+  if(!inf) {
+    error("unable to open input file");
+    return;
+  }
+  input_t *input = input_new(inf);
+  char  *src = input->is_map ? input->data : "";
+  ulong len  = input->is_map ? input->len : 0;
+  int   all  = !this->len;
+
+  // unchanged head and tail of the source
+  ulong min = len < this->src_len ? len : this->src_len;
+  ulong head = 0, tail = 0;
+  while(head < min && src[head] == this->src[head]) head++;
+  while(tail < min - head && src[len - 1 - tail] == this->src[this->src_len - 1 - tail]) tail++;
+  if(!all && head == len && len == this->src_len) {
+    input_free(input);
+    return;
+  }
+  long  delta = len - this->src_len;
+  ulong keep  = this->src_len - tail;  // old offsets from here on are unchanged
+  // the #line directives of the tail are only right if it is on the
+  // same lines as before
+  int moved = this->lines && watch_newlines(this->src + head, keep - head) != watch_newlines(src + head, len - tail - head);
+
+  // items in front of the change | a token may look one byte past its end
+  ulong first = 0;
+  while(first < this->len && this->items[first].end < head) first++;
+  ulong start = first ? this->items[first - 1].end : 0;
+
+  parser_t *parser = parser_create(input);
+  parser_configure(parser, this->packrat, this->vm);
+  input_seek(input, start);
+
+  item_t *items = 0;
+  ulong items_len = 0, items_cap = 0;
+  ulong reuse = this->len;
+  for(ulong at = start, old = first, more = 1; more;) {
+    char *text = 0;
+    size_t text_len = 0;
+    output_t *output = output_new(open_memstream(&text, &text_len));
+    if(this->lines) output_lines(output, input, this->in_path);
+    output->prelude = this->prelude;
+    node_t *node = parse(parser);
+    if(!node) {
+      parser_recover(parser);
+    } else {
+      more = item_emit(node, output);
+      parser_commit(parser);
+    }
+    output_free(output);
+    ulong end = more ? lexer_offset(parser->lexer, lexer_tell(parser->lexer)) : len;
+    items = grow(items, &items_cap, items_len, sizeof(item_t));
+    items[items_len++] = (item_t){ at, end, text, text_len };
+    at = end;
+    // an old item starts here and all of it is unchanged
+    while(old < this->len && (long)this->items[old].start + delta < (long)end) old++;
+    if(more && !moved && old < this->len && this->items[old].start >= keep && (long)this->items[old].start + delta == (long)end) {
+      reuse = old;
+      break;
+    }
+  }
+  ulong errors = parser->lexer->errors;
+  dealloc(this->src);
+  this->src = alloc(len + 1);
+  memcpy(this->src, src, len);
+  this->src_len = len;
+  // also releases the input
+  parser_free(parser);
+
+  // old head | new items | old tail moved by delta
+  ulong old_len = this->len;
+  item_t *old_items = this->items;
+  ulong old_text = 0, new_text = 0;
+  this->items = 0;
+  this->len = this->cap = 0;
+  for(ulong i = 0; i < first; i++) watch_push(this, old_items[i]);
+  for(ulong i = 0; i < items_len; i++) {
+    watch_push(this, items[i]);
+    new_text += items[i].len;
+  }
+  for(ulong i = first; i < reuse; i++) {
+    old_text += old_items[i].len;
+    free(old_items[i].text);
+  }
+  for(ulong i = reuse; i < old_len; i++) {
+    old_items[i].start += delta;
+    old_items[i].end += delta;
+    watch_push(this, old_items[i]);
+  }
+  dealloc(old_items);
+  dealloc(items);
+
+  // the tail of the output only moves if the new items differ in size
+  ulong last = all || old_text != new_text ? this->len : first + items_len;
+  watch_write(this, first, last, all);
+  printf("updated %s: %lu of %lu items parsed, %lu syntax errors\n",
+         this->out_path, items_len, this->len, errors);
+  fflush(stdout);
+}
+
+watch_t *watch_new(char *in_path, char *out_path, int packrat, int vm, int lines, int prelude) {
+  watch_t *res = alloc(sizeof(watch_t));
+  memset(res, 0, sizeof(watch_t));
+  res->in_path  = in_path;
+  res->out_path = out_path;
+  res->packrat  = packrat;
+  res->vm       = vm;
+  res->lines    = lines;
+  res->prelude  = prelude;
+  if(prelude == PRELUDE_HEADER) prelude_header_write(out_path);
+  watch_changed(res);
+  watch_update(res);
+  return res;
+}
+
+// waits for changes of the source | never returns
+// inotify watches the directory, so editors that replace the file
+// are seen too. only finished writes count | a file truncated and
+// rewritten in place is not parsed half written. without inotify the
+// source is polled and parsed once it stayed the same for a poll
+void watch_run(watch_t *this) {
+#ifdef __linux__
+  char dir[MAX_STR_LEN] = ".";
+  char *slash = strrchr(this->in_path, '/');
+  if(slash) snprintf(dir, sizeof(dir), "%.*s", (int)(slash - this->in_path + 1), this->in_path);
+  int fd = inotify_init();
+  if(fd >= 0 && inotify_add_watch(fd, dir, IN_CLOSE_WRITE | IN_MOVED_TO) >= 0) {
+    char *name = slash ? slash + 1 : this->in_path;
+    char events[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    ssize_t len;
+    // the mtime is too coarse to tell quick writes apart | the source
+    // is compared byte for byte whenever an event names it
+    while((len = read(fd, events, sizeof(events))) > 0) {
+      int hit = 0;
+      for(char *at = events; at < events + len;) {
+        struct inotify_event *event = (struct inotify_event *)at;
+        if(event->len && !strcmp(event->name, name)) hit = 1;
+        at += sizeof(struct inotify_event) + event->len;
+      }
+      if(hit) watch_update(this);
+    }
+  }
+  error("unable to watch %s | polling", dir);
+  if(fd >= 0) close(fd);
+#endif
+  for(int pending = 0;;) {
+    usleep(WATCH_POLL_MS * 1000);
+    if(watch_changed(this)) pending = 1;
+    else if(pending) {
+      pending = 0;
+      watch_update(this);
+    }
+  }
 }
 
 //---------------------------------------
-// FILE_PREFIX 
+// MEM_REPORT
 //---------------------------------------
 
-const char *file_prefix =                 "\
-#define set(lexp, rexp)  (lexp = rexp)   \n\
-#define ref(exp)         (&exp)          \n\
-#define deref(exp)       (*exp)          \n\
-#define get(lexp, rexp)  (lexp.rexp)     \n\
-#define pget(lexp, rexp) (lexp->rexp)    \n\
-#define aget(exp, index) (exp[index])    \n\
-#define cast(exp, type)  ((type)exp)     \n\
-#define size(exp)        (sizeof(exp))   \n\
-#define lst(...)         ( __VA_ARGS__ ) \n\
-#define init(...)        { __VA_ARGS__ } \n\
-// UNARY_OPERATORS                       \n\
-#define inc(exp)         (exp++)         \n\
-#define dec(exp)         (exp--)         \n\
-#define pos(exp)         (+exp)          \n\
-#define neg(exp)         (-exp)          \n\
-#define bnot(exp)        (~exp)          \n\
-#define not(exp)         (!exp)          \n\
-// BINARY_OPERATORS                      \n\
-#define add(lexp, rexp)  (lexp + rexp)   \n\
-#define sub(lexp, rexp)  (lexp - rexp)   \n\
-#define mul(lexp, rexp)  (lexp * rexp)   \n\
-#define div(lexp, rexp)  (lexp / rexp)   \n\
-#define and(lexp, rexp)  (lexp && rexp)  \n\
-#define or(lexp, rexp)   (lexp || rexp)  \n\
-#define mod(lexp, rexp)  (lexp % rexp)   \n\
-#define lt(lexp, rexp)   (lexp < rexp)   \n\
-#define gt(lexp, rexp)   (lexp > rexp)   \n\
-#define eq(lexp, rexp)   (lexp == rexp)  \n\
-#define leq(lexp, rexp)  (lexp <= rexp)  \n\
-#define geq(lexp, rexp)  (lexp >= rexp)  \n\
-#define band(lexp, rexp) (lexp & rexp)   \n\
-#define bor(lexp, rexp)  (lexp | rexp)   \n\
-#define bxor(lexp, rexp) (lexp ^ rexp)   \n\
-#define ls(lexp, rexp)   (lexp << rexp)  \n\
-#define rs(lexp, rexp)   (lexp >> rexp)  \n\
-";
+// what one top-level item cost | node_arena is empty when an item
+// starts, so kept is all it holds once the item is parsed. with
+// --packrat failed alternatives are kept too. kinds holds the objects
+// of each kind made while the item was parsed and emitted
+typedef struct mem_item_t {
+  ulong index, offset;
+  ulong kept, dropped;
+  mem_kind_t kinds[MEM_COUNT];
+} mem_item_t;
+
+// starts the item at offset | dropped and kinds hold the counts so far
+// until the item is done
+void mem_item_begin(mem_item_t *this, ulong index, ulong offset) {
+  this->index   = index;
+  this->offset  = offset;
+  this->kept    = 0;
+  this->dropped = mem.wasted;
+  memcpy(this->kinds, mem.kinds, sizeof(mem.kinds));
+  mem.phase = MEM_PARSE;
+}
+
+// the item is parsed, its tree is emitted next
+void mem_item_parsed(mem_item_t *this) {
+  node_held();
+  this->kept    = arena_mark(&node_arena);
+  this->dropped = mem.wasted - this->dropped;
+  mem.phase = MEM_EMIT;
+}
+
+// the item is emitted | the largest by tree bytes is kept
+void mem_item_end(mem_item_t *this, mem_item_t *largest) {
+  for(int i = 0; i < MEM_COUNT; i++) {
+    this->kinds[i].made  = mem.kinds[i].made - this->kinds[i].made;
+    this->kinds[i].bytes = mem.kinds[i].bytes - this->kinds[i].bytes;
+  }
+  if(this->kept + this->dropped > largest->kept + largest->dropped) *largest = *this;
+}
+
+void mem_report(mem_item_t *largest, ulong items) {
+  static const char *names[MEM_COUNT] = { "node_t", "str_t", "comb_t", "stack_t" };
+  node_held();
+  fprintf(stderr, "%-24s %12lu bytes\n", "heap peak", mem.peak);
+  fprintf(stderr, "%-24s %12lu bytes\n", "  while parsing", mem.phase_peak[MEM_PARSE]);
+  fprintf(stderr, "%-24s %12lu bytes\n", "  while emitting", mem.phase_peak[MEM_EMIT]);
+  fprintf(stderr, "%-24s %12lu bytes\n", "heap at the end", mem.live);
+  fprintf(stderr, "%-24s %12lu bytes\n", "failed alternatives", mem.wasted);
+  if(items) {
+    fprintf(stderr, "largest of %lu items: #%lu at byte %lu, %lu tree bytes kept, %lu dropped\n",
+            items, largest->index, largest->offset, largest->kept, largest->dropped);
+  }
+  // node_t holds the string literals too | str_t the interned names
+  fprintf(stderr, "%-24s %12s %12s %12s %12s %12s\n",
+          "kind", "made", "bytes", "peak held", "item made", "item bytes");
+  for(int i = 0; i < MEM_COUNT; i++) {
+    mem_kind_t *k = &mem.kinds[i];
+    fprintf(stderr, "%-24s %12lu %12lu %12lu %12lu %12lu\n", names[i], k->made, k->bytes,
+            k->peak, largest->kinds[i].made, largest->kinds[i].bytes);
+  }
+}
 
 //---------------------------------------
 //---------------------------------------
 
 
+#ifndef NO_MAIN
+
 int main(int argc, char **argv) {
   printf("+---------------------------+\n");
   printf("| Starting SC-Lang Compiler |\n");
@@ -1712,77 +4644,131 @@ int main(int argc, char **argv) {
   printf("| Version: 0.0.1            |\n");
   printf("+---------------------------+\n");
 
-  // open input file
-  if(argc < 2) panic("no input file specified");
-  FILE *inf = fopen(argv[1], "r");
-  if(!inf) panic("unable to open input file");
+  // options | everything else are the input and output file
+  int packrat = 0;
+  int vm = 0;
+  int gen = 0;
+  int profile = 0;
+  int watch = 0;
+  int mem_report_on = 0;
+  int lines = 0;
+  int prelude = PRELUDE_NONE;
+  char *files[2] = { 0, 0 };
+  int file_count = 0;
+  for(int i = 1; i < argc; i++) {
+    if(!strcmp(argv[i], "--packrat")) {
+      packrat = 1;
+    } else if(!strcmp(argv[i], "--vm")) {
+      vm = 1;
+    } else if(!strcmp(argv[i], "--gen-parser")) {
+      gen = 1;
+    } else if(!strcmp(argv[i], "--watch")) {
+      watch = 1;
+    } else if(!strcmp(argv[i], "--mem-report")) {
+      mem_report_on = 1;
+    } else if(!strcmp(argv[i], "--line-directives")) {
+      lines = 1;
+    } else if(!strcmp(argv[i], "--prelude")) {
+      prelude = PRELUDE_USED;
+    } else if(!strcmp(argv[i], "--prelude-header")) {
+      prelude = PRELUDE_HEADER;
+#ifdef PROFILE_PARSER
+    } else if(!strcmp(argv[i], "--profile-parser")) {
+      profile = 1;
+#endif
+    } else if(file_count < 2 && (argv[i][0] != '-' || !argv[i][1])) {
+      files[file_count++] = argv[i];
+    } else {
+      panic("unknown argument %s", argv[i]);
+    }
+  }
+
+  // the grammar as c | the only file is the output
+  if(gen) {
+    if(!files[0]) panic("no output file specified");
+    FILE *outf = fopen(files[0], "w");
+    if(!outf) panic("unable to open outpuf file");
+    output_t *output = output_new(outf);
+    parser_t *parser = parser_create(0);
+    gen_parser(parser, output);
+    parser_free(parser);
+    output_free(output);
+    return 0;
+  }
+
+  // keeps the output up to date | does not return
+  if(watch) {
+    if(!files[0] || !strcmp(files[0], "-") || !files[1]) panic("--watch needs an input and an output file");
+    watch_run(watch_new(files[0], files[1], packrat, vm, lines, prelude));
+  }
+
+  // open input file | '-' reads from stdin
+  if(!files[0]) panic("no input file specified");
+  FILE *inf = 0;
+  if(strcmp(files[0], "-")) {
+    inf = fopen(files[0], "r");
+    if(!inf) panic("unable to open input file");
+  }
 
   // open output file
   FILE *outf = 0;
-  if(argc == 3) {
-    outf = fopen(argv[2], "w");
+  if(files[1]) {
+    outf = fopen(files[1], "w");
     if(!outf) panic("unable to open outpuf file");
   }
 
   input_t  *input  = input_new(inf);
   output_t *output = output_new(outf);
+  if(lines) output_lines(output, input, strcmp(files[0], "-") ? files[0] : "<stdin>");
   
   parser_t *parser = parser_create(input);
+  parser_configure(parser, packrat, vm);
+  if(profile && (vm || !parser->base)) panic("--profile-parser needs the combinator interpreter");
   
-  // print prefix
-  emitf(output, "%s\n", file_prefix);
+  // the builtins are lowered to c operators unless there is a prelude
+  output->prelude = prelude;
+  if(prelude == PRELUDE_HEADER) {
+    prelude_header_write(files[1]);
+    emit_line(output, "#include \"" PRELUDE_HEADER_NAME "\"");
+  }
 
+  mem_item_t item, largest = { 0 };
+  ulong items = 0;
   for(node_t *node = 0;;) {
+    mem_item_begin(&item, items, lexer_offset(parser->lexer, lexer_tell(parser->lexer)));
     node = parse(parser);
     if(!node) {
-      error("unable to parse complete input");
-      break;
-    }
-    switch(node->type) {
-      case STRUCT_NODE: {
-        log("parsed struct");
-        struct_emit(node, output);
-        break;
-      }
-      case FUN_NODE: {
-        log("parsed function");
-        fun_emit(node, output);
-        break;
-      }
-      case STRUCT_DECL_NODE: {
-        log("parsed struct forward declaration");
-        struct_decl_emit(node, output);
-        break;
-      }
-      case VAR_DEF_NODE: {
-        log("parsed variable definition");
-        var_def_emit(node, output);
-        break;
-      }
-      case FUN_DECL_NODE: {
-        log("parsed function declaration");
-        fun_decl_emit(node, output);
-        break;
-      }
-      case VAR_DECL_NODE: {
-        log("parsed variable declaration");
-        var_decl_emit(node, output);
-        break;
-      }
-      case EOF_NODE: {
-        printf("done!\n");
-        goto cleanup;
-      }
-      default:
-        panic("parsed undefined node");
+      parser_recover(parser);
+      continue;
     }
-    node_free(node);
+    mem_item_parsed(&item);
+    int more = item_emit(node, output);
+    mem_item_end(&item, &largest);
+    // syntax errors go to stdout too | they have to stay in order
+    if(output->is_std) output_flush(output);
+    items++;
+    if(!more) break;
+    // the item is emitted, the parser never goes back before it
+    parser_commit(parser);
   }
+  printf("done!\n");
 
-cleanup:  
   // cleanup
+  ulong errors = parser->lexer->errors;
+#ifdef PROFILE_PARSER
+  if(profile) prof_report(parser);
+#endif
+  if(mem_report_on) mem_report(&largest, items);
   parser_free(parser);
+  arena_free(&node_arena);
+  intern_free();
   output_free(output);
+  if(errors) {
+    error("%lu syntax error%s", errors, errors == 1 ? "" : "s");
+    return 1;
+  }
   
   return 0;
 }
+
+#endif